@@ -8,6 +8,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/packing.hpp>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -18,10 +19,191 @@
 #include <vector>
 #include <string>
 #include <filesystem>
+#include <memory>
+#include <atomic>
+#include <future>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <unordered_map>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <limits>
+#include <cstdio>
+#include <cstddef>
+#include <cmath>
+#include <cctype>
+#include <optional>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// SIMD kernels: AVX2 when the compiler targets it (e.g. -march=native), SSE2 on any x86-64, scalar elsewhere
+#if defined(__AVX2__)
+#define SMV_SIMD_AVX2 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#define SMV_SIMD_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// Shadow copy of the GL bindings this viewer changes. Binding through it skips calls that would not change anything
+// and counts issued/elided calls, so every bind on the render thread must go through g_glState to keep it valid.
+struct GLStateTracker
+{
+    static constexpr unsigned int kTextureUnits = 16;
+
+    GLuint program = 0;
+    GLuint vertexArray = 0;
+    unsigned int activeUnit = 0;
+    GLuint textures[kTextureUnits] = {};       // GL_TEXTURE_2D binding per unit
+    GLuint bufferTextures[kTextureUnits] = {}; // GL_TEXTURE_BUFFER binding per unit
+    GLuint arrayBuffer = 0, pixelUnpackBuffer = 0, uniformBuffer = 0;
+
+    // Calls forwarded to GL / skipped since the last takeCounters()
+    size_t issued = 0, elided = 0;
+
+    void useProgram(GLuint id)
+    {
+        if (!changes(program, id))
+            return;
+        glUseProgram(id);
+    }
+
+    void bindVertexArray(GLuint id)
+    {
+        if (!changes(vertexArray, id))
+            return;
+        glBindVertexArray(id);
+    }
+
+    void bindTexture(unsigned int unit, GLuint id)
+    {
+        if (textures[unit] == id)
+        {
+            elided++;
+            return;
+        }
+        activeTexture(unit);
+        textures[unit] = id;
+        issued++;
+        glBindTexture(GL_TEXTURE_2D, id);
+    }
+
+    void bindBufferTexture(unsigned int unit, GLuint id)
+    {
+        if (bufferTextures[unit] == id)
+        {
+            elided++;
+            return;
+        }
+        activeTexture(unit);
+        bufferTextures[unit] = id;
+        issued++;
+        glBindTexture(GL_TEXTURE_BUFFER, id);
+    }
+
+    // GL_ELEMENT_ARRAY_BUFFER is VAO state, and the texture and copy buffer targets are only bound around a single upload, so
+    // those are always forwarded, just counted
+    void bindBuffer(GLenum target, GLuint id)
+    {
+        GLuint *binding = target == GL_ARRAY_BUFFER           ? &arrayBuffer
+                          : target == GL_PIXEL_UNPACK_BUFFER ? &pixelUnpackBuffer
+                          : target == GL_UNIFORM_BUFFER      ? &uniformBuffer
+                                                              : nullptr;
+        if (binding && !changes(*binding, id))
+            return;
+        if (!binding)
+            issued++;
+        glBindBuffer(target, id);
+    }
+
+    // glBindBufferBase also changes the generic binding
+    void bindUniformBufferBase(GLuint index, GLuint id)
+    {
+        uniformBuffer = id;
+        issued++;
+        glBindBufferBase(GL_UNIFORM_BUFFER, index, id);
+    }
+
+    // Deleting a bound object reverts its bindings to 0, which the shadow has to follow
+    void deleteTexture(GLuint id)
+    {
+        for (unsigned int unit = 0; unit < kTextureUnits; ++unit)
+        {
+            if (textures[unit] == id)
+                textures[unit] = 0;
+            if (bufferTextures[unit] == id)
+                bufferTextures[unit] = 0;
+        }
+        glDeleteTextures(1, &id);
+    }
+
+    void deleteBuffer(GLuint id)
+    {
+        for (GLuint *bound : {&arrayBuffer, &pixelUnpackBuffer, &uniformBuffer})
+            if (*bound == id)
+                *bound = 0;
+        glDeleteBuffers(1, &id);
+    }
+
+    void deleteVertexArray(GLuint id)
+    {
+        if (vertexArray == id)
+            vertexArray = 0;
+        glDeleteVertexArrays(1, &id);
+    }
+
+    // Returns {issued, elided} and starts counting afresh
+    std::pair<size_t, size_t> takeCounters()
+    {
+        std::pair<size_t, size_t> counters(issued, elided);
+        issued = elided = 0;
+        return counters;
+    }
+
+private:
+    void activeTexture(unsigned int unit)
+    {
+        if (!changes(activeUnit, unit))
+            return;
+        glActiveTexture(GL_TEXTURE0 + unit);
+    }
+
+    // Updates the shadow value; false (and counted as elided) if it already matched
+    template <typename T>
+    bool changes(T &shadow, T value)
+    {
+        if (shadow == value)
+        {
+            elided++;
+            return false;
+        }
+        shadow = value;
+        issued++;
+        return true;
+    }
+};
+
+// Global GL state tracker (render thread only)
+GLStateTracker g_glState;
 
 struct Shader
 {
-    GLuint id = 0; // Initialize to 0
+    GLuint id = 0;                                  // Initialize to 0
+    std::unordered_map<std::string, GLint> uniforms; // Locations of the active default-block uniforms, reflected at link time
     Shader(const char *vsPath, const char *fsPath)
     {
         auto load = [&](const char *path)
@@ -100,163 +282,247 @@ struct Shader
         // Shaders are linked, no longer needed
         glDeleteShader(vsID);
         glDeleteShader(fsID);
+
+        if (id != 0)
+            reflectUniforms();
     }
     void use() const
     {
         if (id != 0)
-            glUseProgram(id);
+            g_glState.useProgram(id);
+    }
+
+    // Cached location of a uniform, -1 if the program has no such active uniform (like glGetUniformLocation).
+    // Resolve locations once and keep them; this is still a string lookup.
+    GLint uniformLocation(const std::string &name) const
+    {
+        auto it = uniforms.find(name);
+        return it == uniforms.end() ? -1 : it->second;
+    }
+
+    // Assigns a named uniform block to a uniform buffer binding point
+    void bindUniformBlock(const char *blockName, GLuint binding) const
+    {
+        if (id == 0)
+            return;
+        GLuint block = glGetUniformBlockIndex(id, blockName);
+        if (block == GL_INVALID_INDEX)
+            spdlog::warn("Shader has no uniform block: {}", blockName);
+        else
+            glUniformBlockBinding(id, block, binding);
+    }
+
+private:
+    void reflectUniforms()
+    {
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<char> name(std::max(maxLength, 1));
+        for (GLint i = 0; i < count; ++i)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(id, static_cast<GLuint>(i), maxLength, &length, &size, &type, name.data());
+            std::string uniformName(name.data(), length);
+            GLint location = glGetUniformLocation(id, uniformName.c_str());
+            if (location < 0)
+                continue; // Member of a uniform block
+            if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0)
+                uniformName.resize(uniformName.size() - 3); // Arrays are reported as "name[0]"
+            uniforms[uniformName] = location;
+        }
     }
 };
 
+// Handle of a texture in the TextureRegistry (0 is invalid)
+using TextureHandle = uint32_t;
+
 struct TextureInfo
 {
     GLuint id = 0;
-    std::string type; // e.g., "texture_diffuse", "texture_specular"
-    std::string path; // Full path used for loading/caching the texture
+    std::string type;            // e.g., "texture_diffuse", "texture_specular"
+    TextureHandle handle = 0;    // Registry entry; its key is the full path used for loading/caching the texture
 };
 
-struct Mesh
+// Vertex encodings a Mesh can be uploaded with
+enum class VertexFormat : uint32_t
 {
-    GLuint VAO = 0, VBO = 0, EBO = 0; // Initialized to 0, indicating invalid/unallocated
-    GLsizei indexCount = 0;
-    std::vector<TextureInfo> textures; // Each Mesh can have multiple textures
-
-    Mesh() = default; // Allow default construction, e.g., for std::vector operations
-
-    // Constructor now also receives texture information
-    Mesh(const std::vector<float> &vertexData,
-         const std::vector<unsigned int> &indices,
-         std::vector<TextureInfo> meshTextures)
-        : indexCount((GLsizei)indices.size()), textures(std::move(meshTextures)) // Store textures
-    {
-        if (indexCount == 0 || vertexData.empty())
-            return; // Don't create GL resources for an empty mesh
+    Float = 0,   // Position(3) + Normal(3) + Color(3) + TexCoords(2) as floats = up to 44 bytes
+    Compact = 1, // Quantized CompactVertex = up to 20 bytes, decoded in vs.glsl
+};
 
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
+// Compact vertex: unorm16 position relative to the mesh bounds, octahedral snorm16 normal, unorm8 color, half-float UV
+struct CompactVertex
+{
+    uint16_t position[4]; // xyz in [0, 65535] across boundsMin..boundsMax, w is padding
+    int16_t normal[2];    // Octahedral encoding
+    uint8_t color[4];     // rgb, a is padding
+    uint16_t texCoords[2];
+};
+static_assert(sizeof(CompactVertex) == 20, "CompactVertex must stay tightly packed");
 
-        glBindVertexArray(VAO);
+// Shader attribute locations (see vs.glsl); vertices store their attributes in this order
+enum VertexAttributeLocation : GLuint
+{
+    kPositionAttribute = 0,
+    kNormalAttribute = 1,
+    kColorAttribute = 2,
+    kTexCoordAttribute = 3,
+    kVertexAttributeCount = 4,
+};
 
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER,
-                     vertexData.size() * sizeof(float),
-                     vertexData.data(), GL_STATIC_DRAW);
+// Optional attributes. A model's layout only has the ones some of its meshes need; the shader reads the others as
+// constant attribute values.
+enum VertexAttributeBits : uint32_t
+{
+    kVertexColors = 1u << 0,
+    kVertexTexCoords = 1u << 1,
+    kAllVertexAttributes = kVertexColors | kVertexTexCoords,
+};
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                     indices.size() * sizeof(unsigned int),
-                     indices.data(), GL_STATIC_DRAW);
+// How one attribute is stored in a vertex
+struct VertexAttributeEncoding
+{
+    GLint components;
+    GLenum type;
+    GLboolean normalized;
+    size_t size; // Bytes taken in the vertex, including padding
+};
 
-        // Vertex layout: Position(3) + Normal(3) + Color(3) + TexCoords(2) = 11 floats
-        GLsizei stride = 11 * sizeof(float);
-        // Position attribute (location = 0)
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void *)0);
-        // Normal attribute (location = 1)
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void *)(3 * sizeof(float)));
-        // Color attribute (location = 2)
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void *)(6 * sizeof(float)));
-        // Texture coordinate attribute (location = 3) - New
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, stride, (void *)(9 * sizeof(float)));
+// Encoding of every attribute location, per VertexFormat
+constexpr VertexAttributeEncoding kVertexAttributeEncodings[2][kVertexAttributeCount] = {
+    {{3, GL_FLOAT, GL_FALSE, 12}, {3, GL_FLOAT, GL_FALSE, 12}, {3, GL_FLOAT, GL_FALSE, 12}, {2, GL_FLOAT, GL_FALSE, 8}},
+    // Compact: see CompactVertex. Normals only store xy, z is left at 0 and decoded in the shader.
+    {{3, GL_UNSIGNED_SHORT, GL_TRUE, 8}, {2, GL_SHORT, GL_TRUE, 4}, {3, GL_UNSIGNED_BYTE, GL_TRUE, 4}, {2, GL_HALF_FLOAT, GL_FALSE, 4}},
+};
 
-        glBindVertexArray(0);
-    }
+// Interleaved vertex layout: an encoding plus the optional attributes present. Offsets and stride are constexpr, so the
+// packing code is instantiated per layout (see PackVertices) and SetVertexAttributes reads the same description.
+struct VertexLayout
+{
+    VertexFormat format = VertexFormat::Float;
+    uint32_t attributes = kAllVertexAttributes; // VertexAttributeBits
 
-    // Destructor: Release OpenGL resources
-    ~Mesh()
+    constexpr bool has(GLuint location) const
     {
-        // Ensure OpenGL context is still valid and these handles are valid
-        if (EBO != 0)
-            glDeleteBuffers(1, &EBO);
-        if (VBO != 0)
-            glDeleteBuffers(1, &VBO);
-        if (VAO != 0)
-            glDeleteVertexArrays(1, &VAO);
+        if (location == kColorAttribute)
+            return (attributes & kVertexColors) != 0;
+        if (location == kTexCoordAttribute)
+            return (attributes & kVertexTexCoords) != 0;
+        return true; // Position and normal are always stored
     }
-
-    // Move constructor
-    Mesh(Mesh &&other) noexcept
-        : VAO(other.VAO), VBO(other.VBO), EBO(other.EBO), indexCount(other.indexCount), textures(std::move(other.textures))
+    constexpr const VertexAttributeEncoding &encoding(GLuint location) const
     {
-        // Leave 'other' in a valid but empty state to prevent its destructor from releasing resources
-        other.VAO = 0;
-        other.VBO = 0;
-        other.EBO = 0;
-        other.indexCount = 0;
+        return kVertexAttributeEncodings[format == VertexFormat::Compact ? 1 : 0][location];
     }
-
-    // Move assignment operator
-    Mesh &operator=(Mesh &&other) noexcept
+    constexpr size_t offset(GLuint location) const
     {
-        if (this != &other)
-        {
-            // Release current object's resources
-            if (EBO != 0)
-                glDeleteBuffers(1, &EBO);
-            if (VBO != 0)
-                glDeleteBuffers(1, &VBO);
-            if (VAO != 0)
-                glDeleteVertexArrays(1, &VAO);
-
-            // Transfer ownership from 'other'
-            VAO = other.VAO;
-            VBO = other.VBO;
-            EBO = other.EBO;
-            indexCount = other.indexCount;
-            textures = std::move(other.textures);
-
-            // Leave 'other' in a valid but empty state
-            other.VAO = 0;
-            other.VBO = 0;
-            other.EBO = 0;
-            other.indexCount = 0;
-        }
-        return *this;
+        size_t bytes = 0;
+        for (GLuint l = 0; l < location; ++l)
+            bytes += has(l) ? encoding(l).size : 0;
+        return bytes;
     }
+    constexpr size_t stride() const { return offset(kVertexAttributeCount); }
+
+    bool operator==(const VertexLayout &other) const { return format == other.format && attributes == other.attributes; }
+    bool operator!=(const VertexLayout &other) const { return !(*this == other); }
+};
+static_assert(VertexLayout{VertexFormat::Float, kAllVertexAttributes}.stride() == 11 * sizeof(float), "Full float vertices are 11 floats");
+static_assert(VertexLayout{VertexFormat::Compact, kAllVertexAttributes}.stride() == sizeof(CompactVertex) &&
+                  VertexLayout{VertexFormat::Compact, kAllVertexAttributes}.offset(kTexCoordAttribute) == offsetof(CompactVertex, texCoords),
+              "Full compact vertices must match CompactVertex");
 
-    // Delete copy constructor and copy assignment operator as Mesh manages exclusive resources
-    Mesh(const Mesh &) = delete;
-    Mesh &operator=(const Mesh &) = delete;
+// One level of detail: a range of a mesh's indices and how far (in model units) it may deviate from the full mesh
+struct MeshLod
+{
+    size_t firstIndex = 0;
+    size_t indexCount = 0;
+    float error = 0.0f;
+};
 
-    // draw function now requires the Shader object to set uniforms
-    void draw(const Shader &shaderProgram) const
-    {
-        if (VAO == 0 || indexCount == 0)
-            return; // Don't draw if VAO is invalid or there are no indices
+constexpr size_t kMaxMeshLods = 4; // Including the full-detail level
 
-        bool hasDiffuseTexture = false;
-        unsigned int diffuseTextureUnit = 0; // We bind the diffuse texture to texture unit 0
+// A mesh suballocated from the geometry arena: a range of the arena's index buffer drawn against a base vertex
+struct Mesh
+{
+    GLint baseVertex = 0;   // First vertex of the mesh in the arena's vertex buffer
+    size_t indexOffset = 0; // Byte offset of the first index in the arena's index buffer
+    GLsizei indexCount = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+    std::vector<TextureInfo> textures; // Each Mesh can have multiple textures
+    TextureHandle texture = 0;         // The diffuse texture drawn with the mesh (simplified: the first one), 0 = none
+    GLuint textureId = 0;
+    VertexFormat format = VertexFormat::Float;
+    glm::vec3 positionOffset{0.0f}, positionScale{1.0f}; // Dequantization of compact positions (identity for floats)
+    glm::vec3 boundsMin{0.0f}, boundsMax{0.0f};           // Model-space AABB (of all instances)
+    glm::vec3 sphereCenter{0.0f};                         // Model-space bounding sphere (of all instances)
+    float sphereRadius = 0.0f;
+    GLint instanceBase = 0;                               // First matrix in the arena's instance buffer
+    GLsizei instanceCount = 0;                            // > 0: drawn instanced; 0: node transform baked into the vertices
+    std::vector<MeshLod> lods;                            // Detail levels, finest first; empty if the mesh has only one
+};
 
-        for (const auto &texInfo : textures)
+// Sets up the vertex attributes of 'layout' for the bound VAO and GL_ARRAY_BUFFER.
+// Attributes the layout leaves out are disabled and read as constants: 'constantColor' for colors, (0, 0) for UVs.
+void SetVertexAttributes(const VertexLayout &layout, const glm::vec3 &constantColor)
+{
+    const GLsizei stride = static_cast<GLsizei>(layout.stride());
+    for (GLuint location = 0; location < kVertexAttributeCount; ++location)
+    {
+        if (!layout.has(location))
         {
-            if (texInfo.type == "texture_diffuse" && texInfo.id != 0)
-            {
-                glActiveTexture(GL_TEXTURE0 + diffuseTextureUnit); // Typically GL_TEXTURE0
-                glBindTexture(GL_TEXTURE_2D, texInfo.id);
-                // The diffuse sampler uniform in the shader (e.g., uDiffuseSampler) should be set to this texture unit (0 here)
-                hasDiffuseTexture = true;
-                break; // Simplified: use only the first diffuse texture found
-            }
+            glDisableVertexAttribArray(location);
+            continue;
         }
+        const VertexAttributeEncoding &encoding = layout.encoding(location);
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, encoding.components, encoding.type, encoding.normalized, stride, (void *)layout.offset(location));
+    }
+    // Current attribute values are context state, not VAO state; nothing else in the viewer sets these two
+    glVertexAttrib3f(kColorAttribute, constantColor.r, constantColor.g, constantColor.b);
+    glVertexAttrib2f(kTexCoordAttribute, 0.0f, 0.0f);
+}
 
-        shaderProgram.use(); // Ensure shader is active
-        glUniform1i(glGetUniformLocation(shaderProgram.id, "uHasDiffuseTexture"), hasDiffuseTexture ? 1 : 0);
-        // The uDiffuseSampler uniform is set once in the main render loop if it's always texture unit 0
-
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+// Per-draw uniform locations of the model shader, resolved once after linking
+struct MeshUniforms
+{
+    GLint hasDiffuseTexture = -1;
+    GLint positionOffset = -1;
+    GLint positionScale = -1;
+    GLint octahedralNormals = -1;
+    GLint instanced = -1;
+    GLint instanceBase = -1;
 
-        glBindVertexArray(0);
-        // if (hasDiffuseTexture) {
-        //     glBindTexture(GL_TEXTURE_2D, 0); // Unbind texture (optional)
-        // }
+    MeshUniforms() = default;
+    explicit MeshUniforms(const Shader &shader)
+        : hasDiffuseTexture(shader.uniformLocation("uHasDiffuseTexture")),
+          positionOffset(shader.uniformLocation("uPositionOffset")),
+          positionScale(shader.uniformLocation("uPositionScale")),
+          octahedralNormals(shader.uniformLocation("uOctahedralNormals")),
+          instanced(shader.uniformLocation("uInstanced")),
+          instanceBase(shader.uniformLocation("uInstanceBase"))
+    {
     }
 };
 
+// Contents of the FrameData uniform block (std140: vec3s are padded to vec4, scalars packed into a vec4)
+constexpr GLuint kFrameUniformBinding = 0;
+// Texture unit of the instance transform buffer (unit 0 holds the diffuse texture)
+constexpr unsigned int kInstanceTextureUnit = 1;
+struct FrameUniforms
+{
+    glm::mat4 model;
+    glm::mat4 view;
+    glm::mat4 proj;
+    glm::vec4 viewPos;     // xyz
+    glm::vec4 lightPos;    // xyz
+    glm::vec4 lightColor;  // rgb
+    glm::vec4 lightParams; // ambient strength, specular strength, shininess
+};
+static_assert(sizeof(FrameUniforms) == 3 * 64 + 4 * 16, "FrameUniforms must match the std140 FrameData block");
+
 struct LightConfig
 {
     glm::vec3 position;     // Light source position
@@ -405,9 +671,6 @@ private:
     }
 };
 
-// Global texture cache
-std::vector<TextureInfo> g_loadedTexturesCache;
-
 // Global variables for file drop
 std::string g_droppedModelPath;
 bool g_newModelPathAvailable = false;
@@ -415,6 +678,49 @@ bool g_newModelPathAvailable = false;
 // Global flag to control model auto-rotation
 static bool g_autoRotateModel = true;
 
+// Set when the window system asks for the contents to be redrawn (e.g. after being uncovered)
+static bool g_redrawRequested = false;
+
+void WindowRefreshCallback(GLFWwindow * /*window*/)
+{
+    g_redrawRequested = true;
+}
+
+// What the window title shows; the title string is only rebuilt and set when one of these changes
+struct WindowTitleState
+{
+    std::string status;
+    bool hasModel = false, loading = false, rotating = false;
+    bool valid = false;
+
+    void update(GLFWwindow *window, const std::string &statusMessage, bool modelLoaded, bool loadInProgress, bool autoRotate)
+    {
+        if (valid && status == statusMessage && hasModel == modelLoaded && loading == loadInProgress && rotating == autoRotate)
+            return;
+        valid = true;
+        status = statusMessage;
+        hasModel = modelLoaded;
+        loading = loadInProgress;
+        rotating = autoRotate;
+
+        std::string title = "Model Viewer";
+        if (!hasModel)
+        {
+            title += " - " + status; // Status/prompt while no model is shown
+        }
+        else
+        {
+            if (status.rfind("Loaded: ", 0) == 0)
+                title += " - " + status.substr(8);
+            else if (loading)
+                title += " - " + status; // Keep showing the old model while the new one loads
+            if (!rotating)
+                title += " (Paused)";
+        }
+        glfwSetWindowTitle(window, title.c_str());
+    }
+};
+
 // File drop callback function
 void drop_callback(GLFWwindow *window, int count, const char **paths)
 {
@@ -427,305 +733,5932 @@ void drop_callback(GLFWwindow *window, int count, const char **paths)
     }
 }
 
-// Loads a texture from file or embedded data
-GLuint LoadTexture(
-    const char *texturePathCStr,       // Path provided by Assimp (filename or "*index")
-    const std::string &modelDirectory, // Directory of the model file
-    const aiScene *scene,              // Assimp scene pointer (to access embedded textures)
-    const std::string &modelFilePath   // Full model file path (for unique cache key for embedded textures)
-)
+// Fixed-size pool of worker threads shared by the CPU-side load stages
+struct WorkerPool
 {
-    std::string texturePathAssimp = std::string(texturePathCStr);
-    std::string cacheKey; // Unique key for searching/storing in g_loadedTexturesCache
-    bool isEmbedded = (texturePathAssimp.rfind("*", 0) == 0);
-
-    if (isEmbedded)
-    {
-        cacheKey = modelFilePath + texturePathAssimp; // e.g., "path/to/model.glb*0"
-    }
-    else
+    explicit WorkerPool(unsigned int threadCount)
     {
-        // Construct full path for external files as cache key
-        cacheKey = texturePathAssimp;
-        // If path is relative, prepend model directory
-        if (cacheKey.find(":/") == std::string::npos && cacheKey.find(":\\") == std::string::npos && cacheKey[0] != '/')
-        {
-            cacheKey = modelDirectory + '/' + cacheKey;
-        }
+        for (unsigned int i = 0; i < threadCount; ++i)
+            workers.emplace_back([this]()
+                                 { workerLoop(); });
     }
 
-    // 1. Check global cache
-    for (const auto &texInfo : g_loadedTexturesCache)
+    ~WorkerPool()
     {
-        if (texInfo.path == cacheKey)
         {
-            // spdlog::debug("Reusing cached texture: {}", cacheKey);
-            return texInfo.id;
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
         }
+        wakeup.notify_all();
+        for (auto &worker : workers)
+            worker.join();
     }
 
-    // 2. If not in cache, load the texture
-    GLuint textureID = 0;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = nullptr;
-    const aiTexture *currentEmbeddedTexture = nullptr; // Pointer to the embedded texture from Assimp scene
-    bool stbi_allocated_data = false;                  // Flag to track if memory was allocated by stb_image
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
 
-    if (isEmbedded)
+    // Runs fn(i) for every i in [0, count) and returns when all calls have finished.
+    // The calling thread takes part, so concurrent callers (e.g. overlapping model loads) cannot deadlock the pool.
+    template <typename Fn>
+    void parallelFor(size_t count, Fn &&fn)
     {
-        int textureIndex = std::stoi(texturePathAssimp.substr(1)); // Get index from "*index" string
-        if (scene && textureIndex >= 0 && static_cast<unsigned int>(textureIndex) < scene->mNumTextures)
+        if (count == 0)
+            return;
+
+        struct Batch
         {
-            currentEmbeddedTexture = scene->mTextures[textureIndex]; // Get embedded texture data
-            if (currentEmbeddedTexture->mHeight == 0)
-            { // Compressed format (e.g., PNG, JPG)
-                data = stbi_load_from_memory(
-                    reinterpret_cast<unsigned char *>(currentEmbeddedTexture->pcData),
-                    currentEmbeddedTexture->mWidth, // This is the size of the compressed data
-                    &width, &height, &nrComponents, 0);
-                if (data)
-                    stbi_allocated_data = true; // Mark as stb allocated
-            }
-            else
-            { // Uncompressed format (typically ARGB8888)
-                width = currentEmbeddedTexture->mWidth;
-                height = currentEmbeddedTexture->mHeight;
-                nrComponents = 4; // Assume RGBA for raw aiTexel data
-                data = reinterpret_cast<unsigned char *>(currentEmbeddedTexture->pcData);
-                stbi_allocated_data = false; // Data points directly to Assimp's memory, not stb allocated
-            }
-            if (!data)
+            std::atomic<size_t> next{0};
+            size_t finished = 0; // Guarded by doneMutex
+            std::mutex doneMutex;
+            std::condition_variable done;
+        };
+        auto batch = std::make_shared<Batch>();
+        // Helpers may be dequeued after this call returned, so they only touch the shared batch until they find work
+        auto run = [batch, count, &fn]()
+        {
+            size_t completed = 0;
+            for (size_t i = batch->next.fetch_add(1); i < count; i = batch->next.fetch_add(1))
             {
-                spdlog::error("Failed to process embedded texture: {} from {}", texturePathAssimp, modelFilePath);
+                fn(i);
+                ++completed;
             }
-        }
-        else
-        {
-            spdlog::error("Invalid embedded texture index or scene pointer for: {}", texturePathAssimp);
-        }
-    }
-    else
-    { // External file
-        data = stbi_load(cacheKey.c_str(), &width, &height, &nrComponents, 0);
-        if (data)
-            stbi_allocated_data = true; // Mark as stb allocated
-        else
+            if (completed == 0)
+                return;
+            std::lock_guard<std::mutex> lock(batch->doneMutex);
+            batch->finished += completed;
+            if (batch->finished == count)
+                batch->done.notify_all();
+        };
+
+        size_t helpers = std::min(count - 1, workers.size());
         {
-            spdlog::error("Texture failed to load at path: {} | Reason: {}", cacheKey, stbi_failure_reason());
+            std::lock_guard<std::mutex> lock(mutex);
+            for (size_t h = 0; h < helpers; ++h)
+                tasks.emplace_back(run);
         }
+        wakeup.notify_all();
+
+        run();
+        std::unique_lock<std::mutex> lock(batch->doneMutex);
+        batch->done.wait(lock, [&]()
+                         { return batch->finished == count; });
     }
 
-    if (data)
+private:
+    void workerLoop()
     {
-        GLenum internalFormat = 0;
-        GLenum dataFormat = 0;
-        if (nrComponents == 1)
+        for (;;)
         {
-            internalFormat = GL_RED;
-            dataFormat = GL_RED;
-        }
-        else if (nrComponents == 3)
-        {
-            internalFormat = GL_RGB;
-            dataFormat = GL_RGB;
-        }
-        else if (nrComponents == 4)
-        {
-            internalFormat = GL_RGBA;
-            dataFormat = GL_RGBA;
-        }
-        else
-        {
-            spdlog::error("Texture {} loaded with unsupported {} components.", cacheKey, nrComponents);
-            if (stbi_allocated_data)
-                stbi_image_free(data);       // Free stb allocated memory
-            glDeleteTextures(1, &textureID); // Clean up generated texture ID
-            return 0;
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeup.wait(lock, [this]()
+                            { return stopping || !tasks.empty(); });
+                if (stopping && tasks.empty())
+                    return;
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
         }
+    }
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, dataFormat, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    bool stopping = false;
+};
 
-        if (stbi_allocated_data)
-        { // Free stb allocated memory
-            stbi_image_free(data);
-        }
+// Process-wide pool sized to the machine; the calling thread counts as one of the workers
+WorkerPool &GetWorkerPool()
+{
+    static WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+}
+
+// Resident memory of this process in bytes; zero where the platform does not report it
+struct MemoryUsage
+{
+    size_t resident = 0;
+    size_t peakResident = 0; // High-water mark since the process started or the last ResetPeakMemoryUsage()
+};
 
-        TextureInfo newTexCacheEntry;
-        newTexCacheEntry.id = textureID;
-        newTexCacheEntry.path = cacheKey; // Use the unique cache key
-        g_loadedTexturesCache.push_back(newTexCacheEntry);
-        spdlog::info("Loaded texture: {} (ID: {})", cacheKey, textureID);
+MemoryUsage GetMemoryUsage()
+{
+    MemoryUsage usage;
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        usage.resident = counters.WorkingSetSize;
+        usage.peakResident = counters.PeakWorkingSetSize;
     }
-    else
-    {                                    // If data is null, loading failed
-        glDeleteTextures(1, &textureID); // Clean up generated texture ID
-        return 0;
+#elif defined(__linux__)
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        // e.g. "VmHWM:    123456 kB"
+        if (line.rfind("VmRSS:", 0) == 0)
+            usage.resident = std::strtoull(line.c_str() + 6, nullptr, 10) * 1024;
+        else if (line.rfind("VmHWM:", 0) == 0)
+            usage.peakResident = std::strtoull(line.c_str() + 6, nullptr, 10) * 1024;
     }
-    return textureID;
+#endif
+    return usage;
 }
 
-// Helper function to load material textures from Assimp material
-std::vector<TextureInfo> loadMaterialTextures(
-    aiMaterial *mat,
-    const std::string &modelDirectory,
-    const aiScene *scene,            // Pass Assimp scene for embedded textures
-    const std::string &modelFilePath // Pass model file path for unique embedded texture keys
-)
+// Starts a new peak measurement. Only Linux can reset the high-water mark; elsewhere the peak covers the whole process lifetime.
+void ResetPeakMemoryUsage()
 {
-    std::vector<TextureInfo> textures;
+#ifdef __linux__
+    std::ofstream("/proc/self/clear_refs") << "5";
+#endif
+}
+
+// Read-only memory mapping of a whole file
+struct MappedFile
+{
+    MappedFile() = default;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
 
-    // Try loading PBR base color textures first (common for glTF/GLB)
-    for (unsigned int i = 0; i < mat->GetTextureCount(aiTextureType_BASE_COLOR); i++)
+    ~MappedFile()
     {
-        aiString str;
-        mat->GetTexture(aiTextureType_BASE_COLOR, i, &str);
-        GLuint textureId = LoadTexture(str.C_Str(), modelDirectory, scene, modelFilePath);
-        if (textureId != 0)
-        {
-            TextureInfo texture;
-            texture.id = textureId;
-            texture.type = "texture_diffuse"; // Treat as diffuse for our simple shader
-            // Get the canonical path from cache for consistency
-            for (const auto &cachedTex : g_loadedTexturesCache)
-            {
-                if (cachedTex.id == textureId)
-                {
-                    texture.path = cachedTex.path;
-                    break;
-                }
-            }
-            textures.push_back(texture);
-        }
+#ifdef _WIN32
+        if (view)
+            UnmapViewOfFile(view);
+        if (mapping)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+#else
+        if (view && length > 0)
+            munmap(view, length);
+#endif
     }
 
-    // If no base color textures found, try traditional diffuse textures
-    if (textures.empty())
+    // Maps 'path'; returns nullptr if the file cannot be opened or is empty
+    static std::unique_ptr<MappedFile> open(const std::string &path)
     {
-        for (unsigned int i = 0; i < mat->GetTextureCount(aiTextureType_DIFFUSE); i++)
+        auto mapped = std::make_unique<MappedFile>();
+#ifdef _WIN32
+        mapped->file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (mapped->file == INVALID_HANDLE_VALUE)
+            return nullptr;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(mapped->file, &fileSize) || fileSize.QuadPart == 0)
+            return nullptr;
+        mapped->length = static_cast<size_t>(fileSize.QuadPart);
+        mapped->mapping = CreateFileMappingA(mapped->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapped->mapping)
+            return nullptr;
+        mapped->view = MapViewOfFile(mapped->mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!mapped->view)
+            return nullptr;
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return nullptr;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0)
         {
-            aiString str;
-            mat->GetTexture(aiTextureType_DIFFUSE, i, &str);
-            GLuint textureId = LoadTexture(str.C_Str(), modelDirectory, scene, modelFilePath);
-            if (textureId != 0)
-            {
-                TextureInfo texture;
-                texture.id = textureId;
-                texture.type = "texture_diffuse";
-                for (const auto &cachedTex : g_loadedTexturesCache)
-                {
-                    if (cachedTex.id == textureId)
-                    {
-                        texture.path = cachedTex.path;
-                        break;
-                    }
-                }
-                textures.push_back(texture);
-            }
+            close(fd);
+            return nullptr;
         }
+        mapped->length = static_cast<size_t>(st.st_size);
+        void *view = mmap(nullptr, mapped->length, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd); // The mapping keeps its own reference to the file
+        if (view == MAP_FAILED)
+            return nullptr;
+        mapped->view = view;
+#endif
+        return mapped;
     }
-    return textures;
-}
 
-// Loads a model from file
-std::vector<Mesh> loadModel(const std::string &path, const std::string &directory, const glm::vec3 &defaultColor = glm::vec3(0.8f, 0.8f, 0.8f))
-{
-    Assimp::Importer importer;
-    const aiScene *scene = importer.ReadFile(path, // 'path' is the full model path
-                                             aiProcess_Triangulate |
-                                                 aiProcess_GenSmoothNormals |
-                                                 aiProcess_FlipUVs | // Often needed as OpenGL UVs origin (0,0) is bottom-left
-                                                 aiProcess_JoinIdenticalVertices |
-                                                 aiProcess_ValidateDataStructure);
-    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+    const unsigned char *data() const { return static_cast<const unsigned char *>(view); }
+    size_t size() const { return length; }
+
+    // Hints that the whole file is about to be read front to back, so the kernel starts reading ahead right away and
+    // more aggressively (no-op on Windows)
+    void adviseSequential() const
     {
-        spdlog::error("Failed to load model '{}': {}", path, importer.GetErrorString());
-        return {};
+#ifndef _WIN32
+        madvise(view, length, MADV_SEQUENTIAL);
+        madvise(view, length, MADV_WILLNEED);
+#endif
     }
 
-    std::vector<Mesh> meshes_vec; // Local vector for meshes of this model
-    for (unsigned int i = 0; i < scene->mNumMeshes; ++i)
+private:
+    void *view = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+};
+
+// 64-bit hash of a byte range (multiply-xorshift over 8-byte words). Not cryptographic, only used to detect changed files.
+uint64_t HashBytes(const unsigned char *data, size_t size, uint64_t seed = 0x9E3779B97F4A7C15ull)
+{
+    constexpr uint64_t kMul = 0xFF51AFD7ED558CCDull;
+    uint64_t h = seed ^ (size * kMul);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
     {
-        aiMesh *mesh_ptr = scene->mMeshes[i]; // Current Assimp mesh
-        std::vector<float> vertexData;
-        // Vertex data: Position(3) + Normal(3) + Color(3) + UV(2) = 11 floats
-        vertexData.reserve(mesh_ptr->mNumVertices * 11);
-        std::vector<unsigned int> indices;
-        std::vector<TextureInfo> meshTextures; // Textures for the current mesh
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        h = (h ^ (word * kMul)) * 0xC4CEB9FE1A85EC53ull;
+        h ^= h >> 29;
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, data + i, size - i);
+    h = (h ^ (tail * kMul)) * 0xC4CEB9FE1A85EC53ull;
+    return h ^ (h >> 32);
+}
 
-        for (unsigned int v = 0; v < mesh_ptr->mNumVertices; ++v)
-        {
-            // Position
-            vertexData.push_back(mesh_ptr->mVertices[v].x);
-            vertexData.push_back(mesh_ptr->mVertices[v].y);
-            vertexData.push_back(mesh_ptr->mVertices[v].z);
-            // Normals
-            if (mesh_ptr->HasNormals())
-            {
-                vertexData.push_back(mesh_ptr->mNormals[v].x);
-                vertexData.push_back(mesh_ptr->mNormals[v].y);
-                vertexData.push_back(mesh_ptr->mNormals[v].z);
-            }
-            else
-            {
-                vertexData.push_back(0.0f);
-                vertexData.push_back(0.0f);
-                vertexData.push_back(0.0f); // Default normal
-            }
-            // Vertex Colors
-            if (mesh_ptr->HasVertexColors(0))
-            {
-                vertexData.push_back(mesh_ptr->mColors[0][v].r);
-                vertexData.push_back(mesh_ptr->mColors[0][v].g);
-                vertexData.push_back(mesh_ptr->mColors[0][v].b);
-            }
-            else
-            {
-                vertexData.push_back(defaultColor.r); // Default color
-                vertexData.push_back(defaultColor.g);
-                vertexData.push_back(defaultColor.b);
-            }
-            // Texture Coordinates (using the first set, if available)
-            if (mesh_ptr->HasTextureCoords(0))
-            {
-                vertexData.push_back(mesh_ptr->mTextureCoords[0][v].x);
-                vertexData.push_back(mesh_ptr->mTextureCoords[0][v].y);
-            }
+// Content hash of a whole file. Fixed-size chunks are hashed in parallel and then combined in order, so the result is deterministic.
+uint64_t HashFileContents(const MappedFile &file)
+{
+    constexpr size_t kChunkSize = size_t(4) << 20;
+    size_t chunkCount = (file.size() + kChunkSize - 1) / kChunkSize;
+    std::vector<uint64_t> chunkHashes(chunkCount);
+    file.adviseSequential();
+    GetWorkerPool().parallelFor(chunkCount, [&](size_t c)
+                                {
+        size_t begin = c * kChunkSize;
+        chunkHashes[c] = HashBytes(file.data() + begin, std::min(kChunkSize, file.size() - begin)); });
+    return HashBytes(reinterpret_cast<const unsigned char *>(chunkHashes.data()), chunkHashes.size() * sizeof(uint64_t), file.size());
+}
+
+// Decoded image pixels waiting to be uploaded on the GL thread
+struct DecodedTexture
+{
+    std::string key; // Cache key: full path for external files, modelFilePath + "*index" for embedded ones
+    int width = 0, height = 0, nrComponents = 0;
+    // Owned pixel memory; freed with stbi_image_free for decoded images and std::free for raw copies
+    std::unique_ptr<unsigned char, void (*)(void *)> pixels{nullptr, &std::free};
+};
+
+// CPU copy of a large mesh kept for software occlusion culling: model-space positions and triangles
+struct Occluder
+{
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+    float surfaceArea = 0.0f; // Of the mesh's bounding box, the order occluders are picked in (see SelectOccluders)
+};
+
+// Index data in the geometry arena starts on 4-byte boundaries, so 32-bit indices stay aligned
+constexpr size_t AlignArenaIndexOffset(size_t offset)
+{
+    return (offset + 3) & ~size_t(3);
+}
+
+// CPU-side data of one mesh, ready for upload
+struct MeshData
+{
+    // Interleaved vertices in 'layout' and triangle indices.
+    // These point either into the storage vectors below (fresh import) or straight into a mapped mesh cache or glTF file,
+    // and are null once the data is in the geometry arena (see inArena).
+    const void *vertices = nullptr;
+    size_t vertexCount = 0;
+    VertexLayout layout;
+    const void *indices = nullptr;
+    size_t indexCount = 0;
+    uint32_t indexSize = sizeof(uint32_t); // Bytes per index: 2 (GL_UNSIGNED_SHORT) or 4 (GL_UNSIGNED_INT)
+    unsigned int materialIndex = 0;
+    glm::vec3 boundsMin{0.0f}, boundsMax{0.0f}; // Object-space AABB of the vertices (compact positions are quantized against it)
+    glm::vec3 sphereCenter{0.0f};               // Object-space bounding sphere of the vertices
+    float sphereRadius = 0.0f;
+    // Node references: 1 = the node transform is baked into the vertices, > 1 = drawn instanced with
+    // ModelData::instanceTransforms[firstInstance, firstInstance + instanceCount), 0 = not referenced (dropped)
+    uint32_t firstInstance = 0, instanceCount = 1;
+    std::vector<MeshLod> lods; // Detail levels within the indices, finest first; empty if there is only one
+    // Set when the loader packed the mesh straight into the mapped geometry arena, at these byte offsets of its back buffers
+    bool inArena = false;
+    size_t arenaVertexOffset = 0, arenaIndexOffset = 0;
+
+    std::vector<unsigned char> vertexStorage;
+    std::vector<unsigned int> indexStorage;       // Working indices of a fresh import
+    std::vector<uint16_t> shortIndexStorage; // Final indices once narrowed to 16 bits
+};
+
+// CPU-side data of a whole model. Everything in here is produced without touching OpenGL,
+// so it can be built on a background thread while the previous model keeps rendering.
+struct ModelData
+{
+    std::string path;
+    std::vector<MeshData> meshes;
+    std::vector<std::vector<std::string>> materialTextureKeys; // Diffuse texture keys per material index
+    std::vector<DecodedTexture> textures;                      // Unique decoded textures referenced by the materials
+    std::vector<glm::mat4> instanceTransforms;                 // Node transforms of instanced meshes (see MeshData)
+    glm::vec3 constantColor{0.8f};                             // Vertex color when the layout has no colors
+    std::vector<Occluder> occluders;                           // Picked by the loader while the vertices are still readable
+    std::vector<std::unique_ptr<MappedFile>> mappings;         // Keep mesh cache or glTF data alive when the meshes point into it
+};
+
+// How a model is packed for the GPU; fixed for the lifetime of a load
+struct LoadSettings
+{
+    VertexFormat vertexFormat = VertexFormat::Float;
+    glm::vec3 defaultColor{0.8f, 0.8f, 0.8f}; // Vertex color of meshes without colors
+    bool optimizeMeshes = false;  // Reorder triangles and vertices for the post-transform cache and vertex fetch
+    bool optimizeOverdraw = false; // Additionally sort triangle clusters against overdraw (requires optimizeMeshes)
+    bool generateLods = false;     // Append simplified detail levels to every triangle mesh
+    bool lowMemory = false;        // Pack in small batches and free Assimp meshes as they are packed (same result, lower peak)
+    bool nativeGltf = true;        // Read glTF files with the native loader, falling back to Assimp for what it does not support
+};
+
+// Cancellation token shared by a background load and its owner.
+// A load is stale as soon as a newer request bumps the latest generation.
+struct LoadCancelToken
+{
+    const std::atomic<uint64_t> *latestGeneration = nullptr;
+    uint64_t generation = 0;
+
+    bool cancelled() const
+    {
+        return latestGeneration && latestGeneration->load(std::memory_order_relaxed) != generation;
+    }
+};
+
+// Write-only mapping of the geometry arena's back buffers (see GeometryArena), handed to a loader thread to pack into
+struct GeometryMapping
+{
+    unsigned char *vertices = nullptr; // nullptr if the buffer could not be mapped
+    unsigned char *indices = nullptr;
+};
+
+// Connects one background load with the GL thread, which alone can map the geometry arena. The loader asks for back
+// buffers of its final size and blocks until ModelLoader::poll has mapped them; the mapping then stays valid until the
+// load has ended and been reaped, so the loader can pack into it from any thread.
+// A streamed load instead pushes its packed meshes batch by batch, and poll appends each batch into the arena and frees
+// it; its sizes are only an estimate, and the loader never writes to the mapping, which may move as the arena grows.
+struct GeometryChannel
+{
+    struct Request
+    {
+        VertexLayout layout;
+        glm::vec3 constantColor{0.8f};
+        size_t vertexBytes = 0, indexBytes = 0;
+        bool streamed = false; // Meshes arrive through push() rather than being packed into the mapping
+    };
+
+    std::function<void()> wake; // Wakes the GL thread's event loop
+
+    // Loader side: waits for the mapping; returns false if the load was cancelled first
+    bool map(const Request &request, GeometryMapping &mapping, LoadCancelToken cancel)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending = request;
+            requested = true;
+        }
+        if (wake)
+            wake();
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!answered)
+        {
+            if (cancel.cancelled())
+                return false;
+            changed.wait_for(lock, std::chrono::milliseconds(10)); // Cancellation is not signalled, so check it now and then
+        }
+        mapping = answer;
+        return true;
+    }
+
+    // GL thread side: the request still waiting for an answer, if any
+    bool takeRequest(Request &request)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!requested || answered)
+            return false;
+        request = pending;
+        return true;
+    }
+
+    void reply(const GeometryMapping &mapping)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            answer = mapping;
+            answered = true;
+        }
+        changed.notify_all();
+    }
+
+    // Loader side of a streamed load: hands over the next finished meshes, in model order
+    void push(std::vector<MeshData> batch)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            batches.push_back(std::move(batch));
+        }
+        if (wake)
+            wake();
+    }
+
+    // GL thread side: the batches pushed since the last call, oldest first
+    std::deque<std::vector<MeshData>> takeBatches()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return std::exchange(batches, {});
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool requested = false, answered = false;
+    Request pending;
+    GeometryMapping answer;
+    std::deque<std::vector<MeshData>> batches;
+};
+
+// Assimp stream serving reads straight from a read-only file mapping
+struct MappedIOStream : Assimp::IOStream
+{
+    std::unique_ptr<MappedFile> file; // nullptr for an empty file, which cannot be mapped
+    size_t position = 0;
+
+    explicit MappedIOStream(std::unique_ptr<MappedFile> mapped) : file(std::move(mapped)) {}
+
+    size_t Read(void *buffer, size_t size, size_t count) override
+    {
+        if (size == 0 || !file)
+            return 0;
+        count = std::min(count, (file->size() - position) / size);
+        std::memcpy(buffer, file->data() + position, count * size);
+        position += count * size;
+        return count;
+    }
+    size_t Write(const void * /*buffer*/, size_t /*size*/, size_t /*count*/) override { return 0; } // Read-only
+    aiReturn Seek(size_t offset, aiOrigin origin) override
+    {
+        // Offsets wrap like Assimp's own stream, so a negated offset seeks backwards
+        size_t base = origin == aiOrigin_SET ? 0 : (origin == aiOrigin_CUR ? position : FileSize());
+        size_t target = base + offset;
+        if (target > FileSize())
+            return aiReturn_FAILURE;
+        position = target;
+        return aiReturn_SUCCESS;
+    }
+    size_t Tell() const override { return position; }
+    size_t FileSize() const override { return file ? file->size() : 0; }
+    void Flush() override {}
+};
+
+// Assimp file system over memory mappings, instead of buffered stdio. Files an importer asks for that do not exist at
+// the given path (material libraries, glTF buffers) are also looked up next to the model, with backslashes read as separators
+// and finally by file name alone, since exporters often write paths from another machine.
+struct MappedIOSystem : Assimp::IOSystem
+{
+    std::filesystem::path modelDirectory;
+
+    explicit MappedIOSystem(std::filesystem::path directory) : modelDirectory(std::move(directory)) {}
+
+    // The existing file 'path' refers to, or an empty path
+    std::filesystem::path resolve(const char *path) const
+    {
+        std::string normalized(path);
+        std::replace(normalized.begin(), normalized.end(), '\\', '/');
+        const std::filesystem::path relative(normalized);
+        const std::filesystem::path candidates[] = {std::filesystem::path(path), relative, modelDirectory / relative,
+                                                    modelDirectory / relative.filename()};
+        std::error_code error;
+        for (const std::filesystem::path &candidate : candidates)
+            if (std::filesystem::is_regular_file(candidate, error))
+                return candidate;
+        return {};
+    }
+
+    bool Exists(const char *path) const override { return !resolve(path).empty(); }
+    char getOsSeparator() const override { return static_cast<char>(std::filesystem::path::preferred_separator); }
+
+    Assimp::IOStream *Open(const char *path, const char *mode) override
+    {
+        if (std::strpbrk(mode, "wa+"))
+            return nullptr; // Importers only read
+        std::filesystem::path resolved = resolve(path);
+        if (resolved.empty())
+            return nullptr;
+        std::unique_ptr<MappedFile> mapped = MappedFile::open(resolved.string());
+        std::error_code error;
+        if (!mapped && std::filesystem::file_size(resolved, error) != 0)
+        {
+            spdlog::warn("Cannot map file for import: {}", resolved.string());
+            return nullptr;
+        }
+        if (mapped)
+            mapped->adviseSequential();
+        return new MappedIOStream(std::move(mapped));
+    }
+    void Close(Assimp::IOStream *stream) override { delete stream; }
+};
+
+// Lets Assimp abort a stale import between its internal steps
+struct CancelProgressHandler : Assimp::ProgressHandler
+{
+    LoadCancelToken token;
+    explicit CancelProgressHandler(LoadCancelToken t) : token(t) {}
+    bool Update(float /*percentage*/) override { return !token.cancelled(); }
+};
+
+// Builds the texture cache key for a path reported by Assimp (filename or "*index")
+std::string TextureCacheKey(const std::string &texturePathAssimp, const std::string &modelDirectory, const std::string &modelFilePath)
+{
+    if (texturePathAssimp.rfind("*", 0) == 0)
+    {
+        return modelFilePath + texturePathAssimp; // e.g., "path/to/model.glb*0"
+    }
+    // Construct full path for external files as cache key
+    std::string cacheKey = texturePathAssimp;
+    // If path is relative, prepend model directory
+    if (cacheKey.find(":/") == std::string::npos && cacheKey.find(":\\") == std::string::npos && cacheKey[0] != '/')
+    {
+        cacheKey = modelDirectory + '/' + cacheKey;
+    }
+    return cacheKey;
+}
+
+// Embedded image payload using the aiTexture convention: height 0 means 'width' bytes of compressed data (PNG, JPG, ...),
+// otherwise width * height raw ARGB8888 texels
+struct EmbeddedTextureSource
+{
+    const unsigned char *data = nullptr;
+    unsigned int width = 0, height = 0;
+};
+
+// Decodes a texture from file (embedded == nullptr) or embedded data. Does not touch OpenGL, safe to call off the GL thread.
+bool DecodeTexture(const std::string &cacheKey, const EmbeddedTextureSource *embedded, DecodedTexture &out)
+{
+    out.key = cacheKey;
+    int width = 0, height = 0, nrComponents = 0;
+
+    if (embedded)
+    {
+        if (embedded->height == 0)
+        { // Compressed format (e.g., PNG, JPG)
+            unsigned char *data = stbi_load_from_memory(
+                embedded->data,
+                embedded->width, // This is the size of the compressed data
+                &width, &height, &nrComponents, 0);
+            out.pixels = {data, &stbi_image_free};
+        }
+        else
+        { // Uncompressed format (typically ARGB8888)
+            width = embedded->width;
+            height = embedded->height;
+            nrComponents = 4; // Assume RGBA for raw aiTexel data
+            // The source (Assimp scene or cache mapping) is released once loading finishes, so keep our own copy of the texels
+            size_t size = static_cast<size_t>(width) * height * 4;
+            out.pixels = {static_cast<unsigned char *>(std::malloc(size)), &std::free};
+            if (out.pixels)
+                std::memcpy(out.pixels.get(), embedded->data, size);
+        }
+        if (!out.pixels)
+        {
+            spdlog::error("Failed to process embedded texture: {}", cacheKey);
+            return false;
+        }
+    }
+    else
+    { // External file
+        unsigned char *data = stbi_load(cacheKey.c_str(), &width, &height, &nrComponents, 0);
+        if (!data)
+        {
+            spdlog::error("Texture failed to load at path: {} | Reason: {}", cacheKey, stbi_failure_reason());
+            return false;
+        }
+        out.pixels = {data, &stbi_image_free};
+    }
+
+    if (nrComponents != 1 && nrComponents != 3 && nrComponents != 4)
+    {
+        spdlog::error("Texture {} loaded with unsupported {} components.", cacheKey, nrComponents);
+        out.pixels.reset();
+        return false;
+    }
+    out.width = width;
+    out.height = height;
+    out.nrComponents = nrComponents;
+    return true;
+}
+
+// Looks up the embedded texture behind an Assimp "*index" path; returns nullptr for external files or invalid indices
+const aiTexture *FindEmbeddedTexture(const std::string &texturePathAssimp, const aiScene *scene)
+{
+    if (texturePathAssimp.rfind("*", 0) != 0)
+        return nullptr;
+    int textureIndex = std::atoi(texturePathAssimp.c_str() + 1); // Get index from "*index" string
+    if (!scene || textureIndex < 0 || static_cast<unsigned int>(textureIndex) >= scene->mNumTextures)
+    {
+        spdlog::error("Invalid embedded texture index or scene pointer for: {}", texturePathAssimp);
+        return nullptr;
+    }
+    return scene->mTextures[textureIndex]; // Get embedded texture data
+}
+
+// Streams decoded pixels into textures through a ring of pixel unpack buffers (GL thread only).
+// Each frame copies at most 'budgetPerFrame' bytes into the next free PBO and issues a glTexSubImage2D of that row band from it,
+// so the copy to the GPU happens asynchronously and a texture-heavy model is spread over several frames instead of one long hitch.
+// A fence per ring slot tells when the GPU has consumed a PBO and it can be written again.
+struct TextureUploader
+{
+    static constexpr int kRingSize = 3;
+
+    size_t budgetPerFrame = size_t(16) << 20; // Bytes per frame; 0 uploads everything in the next frame
+
+    // Queues 'image' for upload into 'texture', which receives its storage and mipmaps along the way
+    void enqueue(TextureHandle handle, GLuint texture, DecodedTexture &&image)
+    {
+        queue.push_back({handle, texture, std::move(image), 0});
+    }
+
+    // Drops a queued upload (the texture was released before it finished)
+    void cancel(TextureHandle handle)
+    {
+        queue.erase(std::remove_if(queue.begin(), queue.end(), [&](const Pending &p)
+                                   { return p.handle == handle; }),
+                    queue.end());
+    }
+
+    bool busy() const { return !queue.empty(); }
+
+    // Uploads the next row bands within this frame's budget; returns the handles whose textures became complete
+    std::vector<TextureHandle> pump()
+    {
+        std::vector<TextureHandle> completed;
+        if (queue.empty())
+            return completed;
+
+        size_t budget = budgetPerFrame == 0 ? std::numeric_limits<size_t>::max() : budgetPerFrame;
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // Row bands start at arbitrary byte offsets
+        while (!queue.empty() && budget > 0)
+        {
+            Slot &slot = ring[nextSlot];
+            if (slot.fence)
+            {
+                // The GPU still reads from this slot: leave the rest for the next frame rather than stalling
+                if (glClientWaitSync(slot.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+                    break;
+                glDeleteSync(slot.fence);
+                slot.fence = nullptr;
+            }
+
+            Pending &p = queue.front();
+            const DecodedTexture &image = p.image;
+            GLenum format = image.nrComponents == 1 ? GL_RED : (image.nrComponents == 3 ? GL_RGB : GL_RGBA);
+            size_t rowBytes = static_cast<size_t>(image.width) * image.nrComponents;
+            // At least one row per step, so textures with rows wider than the budget still make progress
+            int rows = static_cast<int>(std::max<size_t>(1, std::min<size_t>(image.height - p.nextRow, budget / rowBytes)));
+            size_t bytes = rows * rowBytes;
+
+            g_glState.bindTexture(0, p.texture);
+            if (p.nextRow == 0)
+            {
+                g_glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, nullptr);
+            }
+
+            if (slot.pbo == 0)
+                glGenBuffers(1, &slot.pbo);
+            g_glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+            if (slot.capacity < bytes)
+            {
+                glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+                slot.capacity = bytes;
+            }
+            // Unsynchronized is safe: the fence above guarantees the GPU is done with this slot
+            void *dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+                                         GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+            const unsigned char *band = image.pixels.get() + p.nextRow * rowBytes;
+            if (dst)
+            {
+                std::memcpy(dst, band, bytes);
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, p.nextRow, image.width, rows, format, GL_UNSIGNED_BYTE, nullptr); // Sourced from the PBO
+                slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                nextSlot = (nextSlot + 1) % kRingSize;
+            }
+            else
+            {
+                // Upload this band from client memory instead (synchronous), so the texture still completes
+                spdlog::warn("Failed to map texture upload buffer ({} bytes), uploading the rows directly", bytes);
+                g_glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, p.nextRow, image.width, rows, format, GL_UNSIGNED_BYTE, band);
+            }
+
+            p.nextRow += rows;
+            budget -= std::min(budget, bytes);
+            if (p.nextRow == image.height)
+            {
+                glGenerateMipmap(GL_TEXTURE_2D);
+                completed.push_back(p.handle);
+                queue.pop_front(); // Frees the CPU copy of the pixels
+            }
+        }
+        g_glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        return completed;
+    }
+
+    // Drops pending uploads and deletes the ring (before the GL context is destroyed)
+    void clear()
+    {
+        queue.clear();
+        for (auto &slot : ring)
+        {
+            if (slot.fence)
+                glDeleteSync(slot.fence);
+            if (slot.pbo != 0)
+                g_glState.deleteBuffer(slot.pbo);
+            slot = Slot();
+        }
+    }
+
+private:
+    struct Slot
+    {
+        GLuint pbo = 0;
+        size_t capacity = 0;
+        GLsync fence = nullptr;
+    };
+    struct Pending
+    {
+        TextureHandle handle;
+        GLuint texture;
+        DecodedTexture image;
+        int nextRow; // First row not uploaded yet
+    };
+    Slot ring[kRingSize];
+    int nextSlot = 0;
+    std::deque<Pending> queue;
+};
+
+// Reference-counted textures keyed by their cache key (full path, or modelFilePath + "*index" for embedded ones).
+// Each loaded model holds one reference per texture it uses; a texture is deleted when its last model goes away.
+// Pixels reach the GPU through the TextureUploader; a texture is only bound for drawing once its upload is complete.
+// All members are GL-thread only, except isResident, which background loaders use to skip decoding.
+struct TextureRegistry
+{
+    TextureUploader uploader;
+
+    // Adds a reference to a resident texture; returns 0 if 'key' is not resident
+    TextureHandle acquire(const std::string &key)
+    {
+        auto it = byKey.find(key);
+        if (it == byKey.end())
+            return 0;
+        slots[it->second].refCount++;
+        return it->second;
+    }
+
+    // Adds a reference to the texture of 'decoded', queueing its upload first if it is not resident yet
+    TextureHandle acquire(DecodedTexture &&decoded)
+    {
+        if (TextureHandle handle = acquire(decoded.key))
+            return handle;
+
+        TextureHandle handle;
+        if (!freeSlots.empty())
+        {
+            handle = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        else
+        {
+            if (slots.empty())
+                slots.emplace_back(); // Slot 0 stays unused so that 0 can mean "no texture"
+            handle = static_cast<TextureHandle>(slots.size());
+            slots.emplace_back();
+        }
+        Slot &slot = slots[handle];
+        slot.key = decoded.key;
+        slot.refCount = 1;
+        slot.ready = false;
+        glGenTextures(1, &slot.id);
+        g_glState.bindTexture(0, slot.id);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        {
+            std::lock_guard<std::mutex> lock(keyMutex);
+            byKey.emplace(decoded.key, handle);
+        }
+        spdlog::info("Queued texture upload: {} (ID: {}, {}x{})", decoded.key, slot.id, decoded.width, decoded.height);
+        uploader.enqueue(handle, slot.id, std::move(decoded));
+        return handle;
+    }
+
+    // Drops a reference; the GL texture is deleted with the last one
+    void release(TextureHandle handle)
+    {
+        if (handle == 0 || handle >= slots.size() || slots[handle].refCount == 0)
+            return;
+        Slot &slot = slots[handle];
+        if (--slot.refCount > 0)
+            return;
+        spdlog::info("Released texture: {} (ID: {})", slot.key, slot.id);
+        if (!slot.ready)
+            uploader.cancel(handle);
+        g_glState.deleteTexture(slot.id);
+        {
+            std::lock_guard<std::mutex> lock(keyMutex);
+            byKey.erase(slot.key);
+        }
+        slot = Slot();
+        freeSlots.push_back(handle);
+    }
+
+    // Advances pending uploads by one frame's budget; returns whether any texture became ready
+    bool processUploads()
+    {
+        bool completed = false;
+        for (TextureHandle handle : uploader.pump())
+        {
+            slots[handle].ready = true;
+            completed = true;
+            spdlog::info("Loaded texture: {} (ID: {})", slots[handle].key, slots[handle].id);
+        }
+        return completed;
+    }
+
+    GLuint glId(TextureHandle handle) const { return handle < slots.size() ? slots[handle].id : 0; }
+    bool isReady(TextureHandle handle) const { return handle < slots.size() && slots[handle].ready; }
+    const std::string &key(TextureHandle handle) const { return slots[handle].key; }
+
+    // Thread-safe: true if a texture with this key is resident (uploaded or queued for upload)
+    bool isResident(const std::string &key) const
+    {
+        std::lock_guard<std::mutex> lock(keyMutex);
+        return byKey.count(key) != 0;
+    }
+
+    // Deletes every texture regardless of references (before the GL context is destroyed)
+    void clear()
+    {
+        uploader.clear();
+        for (auto &slot : slots)
+        {
+            if (slot.id != 0)
+                g_glState.deleteTexture(slot.id);
+        }
+        slots.clear();
+        freeSlots.clear();
+        std::lock_guard<std::mutex> lock(keyMutex);
+        byKey.clear();
+    }
+
+private:
+    struct Slot
+    {
+        std::string key;
+        GLuint id = 0;
+        uint32_t refCount = 0;
+        bool ready = false; // Pixels and mipmaps fully uploaded
+    };
+    std::vector<Slot> slots;
+    std::vector<TextureHandle> freeSlots;
+    std::unordered_map<std::string, TextureHandle> byKey; // Written on the GL thread under keyMutex
+    mutable std::mutex keyMutex;
+};
+
+// Global texture registry
+TextureRegistry g_textureRegistry;
+
+// True once a registry texture has been fully uploaded
+bool TextureReady(TextureHandle handle)
+{
+    return g_textureRegistry.isReady(handle);
+}
+
+// One texture a model needs, resolved to where its bytes come from
+struct TextureDecodeRequest
+{
+    std::string key;               // Cache key (see TextureCacheKey)
+    bool embedded = false;         // Decode from 'source' instead of the file at 'key'
+    EmbeddedTextureSource source;  // Embedded payload; data is null if the embedded index was invalid
+};
+
+// Unique texture requests of one model load, decoded in batches on the worker pool
+struct TextureRequestSet
+{
+    // Adds a request unless its key is already known; returns the index of the request for that key
+    size_t add(TextureDecodeRequest request)
+    {
+        auto it = indexByKey.find(request.key);
+        if (it != indexByKey.end())
+            return it->second;
+        indexByKey.emplace(request.key, requests.size());
+        requests.push_back(std::move(request));
+        return requests.size() - 1;
+    }
+
+    // Decodes every request added since the last call concurrently and appends the results to 'textures' in request order,
+    // so the output does not depend on scheduling. Textures already resident on the GPU are not decoded again but count as usable.
+    void decodePending(std::vector<DecodedTexture> &textures, LoadCancelToken cancel)
+    {
+        size_t first = usable.size();
+        size_t count = requests.size() - first;
+        usable.resize(requests.size(), 0);
+        std::vector<DecodedTexture> results(count);
+        GetWorkerPool().parallelFor(count, [&](size_t i)
+                                    {
+            const TextureDecodeRequest &request = requests[first + i];
+            if (cancel.cancelled())
+                return;
+            if (g_textureRegistry.isResident(request.key))
+                usable[first + i] = 1; // Reused at upload time instead of decoding again
+            else if (request.embedded)
+                usable[first + i] = request.source.data && DecodeTexture(request.key, &request.source, results[i]);
+            else
+                usable[first + i] = DecodeTexture(request.key, nullptr, results[i]); });
+        for (auto &decoded : results)
+        {
+            if (decoded.pixels)
+                textures.push_back(std::move(decoded));
+        }
+    }
+
+    bool isUsable(size_t index) const { return index < usable.size() && usable[index] != 0; }
+    const std::string &key(size_t index) const { return requests[index].key; }
+
+private:
+    std::vector<TextureDecodeRequest> requests;
+    std::vector<char> usable; // Per decoded request (char rather than bool so workers can write concurrently)
+    std::unordered_map<std::string, size_t> indexByKey;
+};
+
+// Decodes the diffuse textures of every material of an Assimp scene and records their cache keys in 'model'.
+// All base color textures are collected and decoded in parallel first; materials without a usable one then fall back
+// to their traditional diffuse textures in a second parallel batch.
+void decodeSceneMaterialTextures(
+    const aiScene *scene,             // Pass Assimp scene for embedded textures
+    const std::string &modelDirectory,
+    const std::string &modelFilePath, // Pass model file path for unique embedded texture keys
+    ModelData &model,
+    LoadCancelToken cancel)
+{
+    TextureRequestSet requestSet;
+    auto collect = [&](const aiMaterial *mat, aiTextureType type)
+    {
+        std::vector<size_t> indices;
+        for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
+        {
+            aiString str;
+            mat->GetTexture(type, i, &str);
+            TextureDecodeRequest request;
+            request.key = TextureCacheKey(str.C_Str(), modelDirectory, modelFilePath);
+            request.embedded = str.C_Str()[0] == '*';
+            if (const aiTexture *texture = request.embedded ? FindEmbeddedTexture(str.C_Str(), scene) : nullptr)
+            {
+                request.source.data = reinterpret_cast<const unsigned char *>(texture->pcData);
+                request.source.width = texture->mWidth;
+                request.source.height = texture->mHeight;
+            }
+            indices.push_back(requestSet.add(std::move(request)));
+        }
+        return indices;
+    };
+    auto usableKeys = [&](const std::vector<size_t> &indices)
+    {
+        std::vector<std::string> keys;
+        for (size_t index : indices)
+        {
+            if (requestSet.isUsable(index))
+                keys.push_back(requestSet.key(index));
+        }
+        return keys;
+    };
+
+    // Try PBR base color textures first (common for glTF/GLB)
+    model.materialTextureKeys.resize(scene->mNumMaterials);
+    std::vector<std::vector<size_t>> baseColor(scene->mNumMaterials);
+    for (unsigned int m = 0; m < scene->mNumMaterials; ++m)
+        baseColor[m] = collect(scene->mMaterials[m], aiTextureType_BASE_COLOR);
+    requestSet.decodePending(model.textures, cancel);
+
+    // If no base color textures found, try traditional diffuse textures
+    std::vector<std::vector<size_t>> diffuse(scene->mNumMaterials);
+    for (unsigned int m = 0; m < scene->mNumMaterials; ++m)
+    {
+        model.materialTextureKeys[m] = usableKeys(baseColor[m]);
+        if (model.materialTextureKeys[m].empty())
+            diffuse[m] = collect(scene->mMaterials[m], aiTextureType_DIFFUSE);
+    }
+    requestSet.decodePending(model.textures, cancel);
+    for (unsigned int m = 0; m < scene->mNumMaterials; ++m)
+    {
+        if (model.materialTextureKeys[m].empty())
+            model.materialTextureKeys[m] = usableKeys(diffuse[m]);
+    }
+}
+
+// World transform baked into the vertices of a mesh that only one node references
+struct VertexTransform
+{
+    glm::mat4 position;
+    glm::mat3 normal; // Inverse transpose of the upper 3x3
+};
+
+glm::mat4 AssimpToGlm(const aiMatrix4x4 &m)
+{
+    // aiMatrix4x4 is row-major, glm takes columns
+    return glm::mat4(m.a1, m.b1, m.c1, m.d1,
+                     m.a2, m.b2, m.c2, m.d2,
+                     m.a3, m.b3, m.c3, m.d3,
+                     m.a4, m.b4, m.c4, m.d4);
+}
+
+glm::vec3 TransformedPosition(const glm::vec3 &position, const VertexTransform *transform)
+{
+    return transform ? glm::vec3(transform->position * glm::vec4(position, 1.0f)) : position;
+}
+
+glm::vec3 TransformedNormal(glm::vec3 normal, const VertexTransform *transform)
+{
+    if (!transform)
+        return normal;
+    normal = transform->normal * normal;
+    float length = glm::length(normal);
+    return length > 0.0f ? normal / length : normal;
+}
+
+// Float attribute arrays of one source mesh, from Assimp or straight from a glTF buffer. Element v of an attribute
+// starts v * step bytes after its pointer; a null pointer means the mesh lacks the attribute (zero normals and UVs,
+// the default color). Positions, normals and colors are read as 3 floats, UVs as 2.
+struct VertexStreams
+{
+    const unsigned char *positions = nullptr, *normals = nullptr, *colors = nullptr, *texCoords = nullptr;
+    size_t positionStep = 0, normalStep = 0, colorStep = 0, texCoordStep = 0;
+    unsigned int vertexCount = 0;
+};
+
+// The streams of an Assimp mesh (first color and UV set)
+VertexStreams AssimpVertexStreams(const aiMesh *mesh_ptr)
+{
+    static_assert(sizeof(ai_real) == sizeof(float), "Assimp must be built with single precision");
+    VertexStreams streams;
+    streams.vertexCount = mesh_ptr->mNumVertices;
+    streams.positions = reinterpret_cast<const unsigned char *>(mesh_ptr->mVertices);
+    streams.positionStep = sizeof(aiVector3D);
+    if (mesh_ptr->HasNormals())
+    {
+        streams.normals = reinterpret_cast<const unsigned char *>(mesh_ptr->mNormals);
+        streams.normalStep = sizeof(aiVector3D);
+    }
+    if (mesh_ptr->HasVertexColors(0))
+    {
+        streams.colors = reinterpret_cast<const unsigned char *>(mesh_ptr->mColors[0]);
+        streams.colorStep = sizeof(aiColor4D);
+    }
+    if (mesh_ptr->HasTextureCoords(0))
+    {
+        streams.texCoords = reinterpret_cast<const unsigned char *>(mesh_ptr->mTextureCoords[0]);
+        streams.texCoordStep = sizeof(aiVector3D);
+    }
+    return streams;
+}
+
+// Vertices [begin, end) of 'streams' as streams of their own, so a range can be packed into a buffer of just its size
+VertexStreams VertexStreamRange(const VertexStreams &streams, unsigned int begin, unsigned int end)
+{
+    VertexStreams range = streams;
+    auto advance = [begin](const unsigned char *&stream, size_t step)
+    {
+        if (stream)
+            stream += begin * step;
+    };
+    advance(range.positions, streams.positionStep);
+    advance(range.normals, streams.normalStep);
+    advance(range.colors, streams.colorStep);
+    advance(range.texCoords, streams.texCoordStep);
+    range.vertexCount = end - begin;
+    return range;
+}
+
+glm::vec3 LoadFloat3(const unsigned char *p)
+{
+    glm::vec3 v;
+    std::memcpy(glm::value_ptr(v), p, sizeof(v));
+    return v;
+}
+
+glm::vec2 LoadFloat2(const unsigned char *p)
+{
+    glm::vec2 v;
+    std::memcpy(glm::value_ptr(v), p, sizeof(v));
+    return v;
+}
+
+// Vertices (or faces) per packing task; big enough to amortize scheduling, small enough to balance huge meshes
+constexpr unsigned int kPackRangeSize = 1u << 16;
+
+// Source vertices per packing batch in low-memory mode; bounds how much of the model exists twice at any time
+constexpr size_t kLowMemoryBatchVertices = size_t(1) << 20;
+
+// Octahedral encoding of a unit vector into two snorm16 values
+void EncodeOctahedral(glm::vec3 n, int16_t out[2])
+{
+    float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    glm::vec2 e(0.0f);
+    if (l1 > 0.0f)
+    {
+        e = glm::vec2(n.x, n.y) / l1;
+        if (n.z < 0.0f)
+        {
+            // Fold the lower hemisphere over the diagonals
+            glm::vec2 folded(1.0f - std::abs(e.y), 1.0f - std::abs(e.x));
+            e = glm::vec2(e.x >= 0.0f ? folded.x : -folded.x, e.y >= 0.0f ? folded.y : -folded.y);
+        }
+    }
+    out[0] = static_cast<int16_t>(std::lround(glm::clamp(e.x, -1.0f, 1.0f) * 32767.0f));
+    out[1] = static_cast<int16_t>(std::lround(glm::clamp(e.y, -1.0f, 1.0f) * 32767.0f));
+}
+
+// Factor mapping offsets from boundsMin to the unorm16 range of compact positions
+glm::vec3 PositionQuantizationScale(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax)
+{
+    glm::vec3 extent = boundsMax - boundsMin;
+    return glm::vec3(extent.x > 0.0f ? 65535.0f / extent.x : 0.0f,
+                     extent.y > 0.0f ? 65535.0f / extent.y : 0.0f,
+                     extent.z > 0.0f ? 65535.0f / extent.z : 0.0f);
+}
+
+void QuantizePosition(const glm::vec3 &p, const glm::vec3 &boundsMin, const glm::vec3 &toUnit, uint16_t out[4])
+{
+    out[0] = static_cast<uint16_t>(std::lround(glm::clamp((p.x - boundsMin.x) * toUnit.x, 0.0f, 65535.0f)));
+    out[1] = static_cast<uint16_t>(std::lround(glm::clamp((p.y - boundsMin.y) * toUnit.y, 0.0f, 65535.0f)));
+    out[2] = static_cast<uint16_t>(std::lround(glm::clamp((p.z - boundsMin.z) * toUnit.z, 0.0f, 65535.0f)));
+    out[3] = 0;
+}
+
+// Per-mesh inputs of PackVertices
+struct VertexPackParams
+{
+    glm::vec3 boundsMin{0.0f}, boundsMax{0.0f}; // Compact positions are quantized against these
+    glm::vec3 defaultColor{0.8f};               // Color of meshes without vertex colors
+    const VertexTransform *transform = nullptr; // Node transform baked into the vertices, if any
+};
+
+#if defined(SMV_SIMD_AVX2) || defined(SMV_SIMD_SSE2)
+// Interleaves float vertices [begin, end) with SSE2. Every source attribute is one unaligned 128-bit load and one store
+// that may spill into the next attribute, which is written right after; only the layout's last attribute is stored
+// exactly, so nothing is written outside the vertex. Missing source attributes are read from a constant with a source
+// step of 0, so the loop has no per-vertex branches. (Each attribute fits one 128-bit register, so AVX2 would only add
+// cross-lane shuffles.) Returns the first vertex not packed: the mesh's last vertex is left to the scalar loop, as a
+// 128-bit load of its position or normal may read past the end of the source array. Every earlier load stays within the
+// next element, since no source step is shorter than the 3 floats read.
+template <uint32_t Attributes, bool Transformed>
+unsigned int InterleaveFloatVertices(const VertexStreams &streams, unsigned int begin, unsigned int end, unsigned char *out,
+                                     const VertexPackParams &params)
+{
+    constexpr VertexLayout layout{VertexFormat::Float, Attributes};
+    constexpr size_t stride = layout.stride();
+    constexpr bool hasColor = layout.has(kColorAttribute), hasTexCoord = layout.has(kTexCoordAttribute);
+    end = std::min(end, streams.vertexCount - 1);
+
+    alignas(16) static const float zeros[4] = {};
+    alignas(16) const float defaultColor[4] = {params.defaultColor.r, params.defaultColor.g, params.defaultColor.b, 0.0f};
+    auto bytes = [](const float *constant)
+    { return reinterpret_cast<const unsigned char *>(constant); };
+    const unsigned char *positions = streams.positions;
+    const unsigned char *normals = streams.normals ? streams.normals : bytes(zeros);
+    const unsigned char *colors = streams.colors ? streams.colors : bytes(defaultColor);
+    const unsigned char *texCoords = streams.texCoords ? streams.texCoords : bytes(zeros);
+    const size_t positionStep = streams.positionStep;
+    const size_t normalStep = streams.normals ? streams.normalStep : 0;
+    const size_t colorStep = streams.colors ? streams.colorStep : 0;
+    const size_t texCoordStep = streams.texCoords ? streams.texCoordStep : 0;
+
+    // Transform columns, with w = 0 for the normal matrix so lane 3 of a transformed normal stays 0
+    __m128 positionColumns[4], normalColumns[3];
+    if constexpr (Transformed)
+    {
+        for (int c = 0; c < 4; ++c)
+            positionColumns[c] = _mm_setr_ps(params.transform->position[c][0], params.transform->position[c][1],
+                                             params.transform->position[c][2], params.transform->position[c][3]);
+        for (int c = 0; c < 3; ++c)
+            normalColumns[c] = _mm_setr_ps(params.transform->normal[c][0], params.transform->normal[c][1],
+                                           params.transform->normal[c][2], 0.0f);
+    }
+    auto splat = [](__m128 v, int lane)
+    {
+        switch (lane)
+        {
+        case 0:
+            return _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0));
+        case 1:
+            return _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1));
+        default:
+            return _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2));
+        }
+    };
+    auto storeExact3 = [](unsigned char *dst, __m128 v)
+    {
+        _mm_storel_pi(reinterpret_cast<__m64 *>(dst), v);
+        _mm_store_ss(reinterpret_cast<float *>(dst + 8), _mm_movehl_ps(v, v));
+    };
+
+    for (unsigned int v = begin; v < end; ++v)
+    {
+        __m128 position = _mm_loadu_ps(reinterpret_cast<const float *>(positions + size_t(v) * positionStep));
+        __m128 normal = _mm_loadu_ps(reinterpret_cast<const float *>(normals + size_t(v) * normalStep));
+        if constexpr (Transformed)
+        {
+            // Same association as glm's matrix-vector products
+            position = _mm_add_ps(_mm_add_ps(_mm_mul_ps(positionColumns[0], splat(position, 0)), _mm_mul_ps(positionColumns[1], splat(position, 1))),
+                                  _mm_add_ps(_mm_mul_ps(positionColumns[2], splat(position, 2)), positionColumns[3]));
+            normal = _mm_add_ps(_mm_add_ps(_mm_mul_ps(normalColumns[0], splat(normal, 0)), _mm_mul_ps(normalColumns[1], splat(normal, 1))),
+                                _mm_mul_ps(normalColumns[2], splat(normal, 2)));
+            __m128 squared = _mm_mul_ps(normal, normal);
+            __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(splat(squared, 0), splat(squared, 1)), splat(squared, 2)));
+            __m128 nonZero = _mm_cmpgt_ps(length, _mm_setzero_ps()); // Zero normals are kept as they are
+            normal = _mm_or_ps(_mm_and_ps(nonZero, _mm_div_ps(normal, length)), _mm_andnot_ps(nonZero, normal));
+        }
+
+        unsigned char *dst = out + size_t(v) * stride;
+        _mm_storeu_ps(reinterpret_cast<float *>(dst + layout.offset(kPositionAttribute)), position);
+        if constexpr (hasColor || hasTexCoord)
+            _mm_storeu_ps(reinterpret_cast<float *>(dst + layout.offset(kNormalAttribute)), normal);
+        else
+            storeExact3(dst + layout.offset(kNormalAttribute), normal);
+        if constexpr (hasColor)
+        {
+            __m128 color = _mm_loadu_ps(reinterpret_cast<const float *>(colors + size_t(v) * colorStep));
+            if constexpr (hasTexCoord)
+                _mm_storeu_ps(reinterpret_cast<float *>(dst + layout.offset(kColorAttribute)), color);
+            else
+                storeExact3(dst + layout.offset(kColorAttribute), color);
+        }
+        if constexpr (hasTexCoord)
+        {
+            __m128 uv = _mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64 *>(texCoords + size_t(v) * texCoordStep));
+            _mm_storel_pi(reinterpret_cast<__m64 *>(dst + layout.offset(kTexCoordAttribute)), uv);
+        }
+    }
+    return std::max(begin, end);
+}
+#endif
+
+// Packs vertices [begin, end) of a source mesh into 'out' (indexed from vertex 0). There is one instantiation per layout,
+// so the per-vertex loop has no format or attribute branches; attributes the layout leaves out are never written.
+// Float layouts go through InterleaveFloatVertices where SIMD is available, unless 'Vectorized' is false.
+template <VertexFormat Format, uint32_t Attributes, bool Vectorized = true>
+void PackVertices(const VertexStreams &streams, unsigned int begin, unsigned int end, unsigned char *out, const VertexPackParams &params)
+{
+    constexpr VertexLayout layout{Format, Attributes};
+    constexpr size_t stride = layout.stride();
+    const glm::vec3 toUnit = PositionQuantizationScale(params.boundsMin, params.boundsMax);
+    auto unorm8 = [](float v)
+    { return static_cast<uint8_t>(std::lround(glm::clamp(v, 0.0f, 1.0f) * 255.0f)); };
+
+    unsigned int v = begin;
+#if defined(SMV_SIMD_AVX2) || defined(SMV_SIMD_SSE2)
+    if constexpr (Format == VertexFormat::Float && Vectorized)
+        v = params.transform ? InterleaveFloatVertices<Attributes, true>(streams, begin, end, out, params)
+                             : InterleaveFloatVertices<Attributes, false>(streams, begin, end, out, params);
+#endif
+    for (; v < end; ++v)
+    {
+        unsigned char *dst = out + static_cast<size_t>(v) * stride;
+        glm::vec3 position = TransformedPosition(LoadFloat3(streams.positions + v * streams.positionStep), params.transform);
+        glm::vec3 normal = streams.normals ? TransformedNormal(LoadFloat3(streams.normals + v * streams.normalStep), params.transform)
+                                           : glm::vec3(0.0f); // Default normal
+        if constexpr (Format == VertexFormat::Compact)
+        {
+            uint16_t quantized[4];
+            QuantizePosition(position, params.boundsMin, toUnit, quantized);
+            std::memcpy(dst + layout.offset(kPositionAttribute), quantized, sizeof(quantized));
+            int16_t octahedral[2];
+            EncodeOctahedral(normal, octahedral);
+            std::memcpy(dst + layout.offset(kNormalAttribute), octahedral, sizeof(octahedral));
+        }
+        else
+        {
+            std::memcpy(dst + layout.offset(kPositionAttribute), glm::value_ptr(position), 3 * sizeof(float));
+            std::memcpy(dst + layout.offset(kNormalAttribute), glm::value_ptr(normal), 3 * sizeof(float));
+        }
+        if constexpr (layout.has(kColorAttribute))
+        {
+            glm::vec3 color = streams.colors ? LoadFloat3(streams.colors + v * streams.colorStep) : params.defaultColor;
+            if constexpr (Format == VertexFormat::Compact)
+            {
+                const uint8_t rgba[4] = {unorm8(color.r), unorm8(color.g), unorm8(color.b), 255};
+                std::memcpy(dst + layout.offset(kColorAttribute), rgba, sizeof(rgba));
+            }
+            else
+            {
+                std::memcpy(dst + layout.offset(kColorAttribute), glm::value_ptr(color), 3 * sizeof(float));
+            }
+        }
+        if constexpr (layout.has(kTexCoordAttribute))
+        {
+            glm::vec2 uv = streams.texCoords ? LoadFloat2(streams.texCoords + v * streams.texCoordStep)
+                                             : glm::vec2(0.0f); // Default UVs
+            if constexpr (Format == VertexFormat::Compact)
+            {
+                const uint16_t half[2] = {glm::packHalf1x16(uv.x), glm::packHalf1x16(uv.y)};
+                std::memcpy(dst + layout.offset(kTexCoordAttribute), half, sizeof(half));
+            }
+            else
+            {
+                std::memcpy(dst + layout.offset(kTexCoordAttribute), glm::value_ptr(uv), 2 * sizeof(float));
+            }
+        }
+    }
+}
+
+using PackVerticesFn = void (*)(const VertexStreams &, unsigned int, unsigned int, unsigned char *, const VertexPackParams &);
+
+// The PackVertices instantiation for a layout
+PackVerticesFn VertexPacker(const VertexLayout &layout)
+{
+    // Indexed by format, then by the optional attribute bits
+    static constexpr PackVerticesFn packers[2][kAllVertexAttributes + 1] = {
+        {PackVertices<VertexFormat::Float, 0>, PackVertices<VertexFormat::Float, 1>,
+         PackVertices<VertexFormat::Float, 2>, PackVertices<VertexFormat::Float, 3>},
+        {PackVertices<VertexFormat::Compact, 0>, PackVertices<VertexFormat::Compact, 1>,
+         PackVertices<VertexFormat::Compact, 2>, PackVertices<VertexFormat::Compact, 3>},
+    };
+    static_assert(kAllVertexAttributes == 3, "One instantiation per attribute subset");
+    return packers[layout.format == VertexFormat::Compact ? 1 : 0][layout.attributes & kAllVertexAttributes];
+}
+
+// Times scalar and vectorized packing of a synthetic full-layout float mesh, with and without a baked node transform,
+// and logs the throughput of both (--benchmark-packing)
+void BenchmarkVertexPacking()
+{
+    constexpr unsigned int kVertices = kPackRangeSize; // One packing task's worth, as in loadModelData
+    constexpr int kRuns = 200;
+    aiMesh mesh; // Owns the arrays below
+    mesh.mNumVertices = kVertices;
+    mesh.mVertices = new aiVector3D[kVertices];
+    mesh.mNormals = new aiVector3D[kVertices];
+    mesh.mColors[0] = new aiColor4D[kVertices];
+    mesh.mTextureCoords[0] = new aiVector3D[kVertices];
+    mesh.mNumUVComponents[0] = 2;
+    for (unsigned int v = 0; v < kVertices; ++v)
+    {
+        float f = static_cast<float>(v);
+        mesh.mVertices[v].x = std::sin(f), mesh.mVertices[v].y = std::cos(f), mesh.mVertices[v].z = f * 1e-4f;
+        mesh.mNormals[v].x = std::cos(f), mesh.mNormals[v].y = 0.0f, mesh.mNormals[v].z = std::sin(f);
+        mesh.mColors[0][v].r = mesh.mColors[0][v].g = mesh.mColors[0][v].b = mesh.mColors[0][v].a = 0.5f;
+        mesh.mTextureCoords[0][v].x = f / kVertices, mesh.mTextureCoords[0][v].y = 1.0f - f / kVertices, mesh.mTextureCoords[0][v].z = 0.0f;
+    }
+    VertexTransform transform;
+    transform.position = glm::rotate(glm::scale(glm::mat4(1.0f), glm::vec3(2.0f)), 0.5f, glm::vec3(0.0f, 1.0f, 0.0f));
+    transform.normal = glm::transpose(glm::inverse(glm::mat3(transform.position)));
+
+    const VertexStreams streams = AssimpVertexStreams(&mesh);
+    constexpr VertexLayout layout{VertexFormat::Float, kAllVertexAttributes};
+    std::vector<unsigned char> scalarOut(kVertices * layout.stride());
+#if defined(SMV_SIMD_AVX2) || defined(SMV_SIMD_SSE2)
+    std::vector<unsigned char> vectorOut(kVertices * layout.stride());
+#endif
+    auto verticesPerSecond = [&](PackVerticesFn pack, std::vector<unsigned char> &out, const VertexPackParams &params)
+    {
+        pack(streams, 0, kVertices, out.data(), params); // Warm up
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < kRuns; ++r)
+            pack(streams, 0, kVertices, out.data(), params);
+        return double(kVertices) * kRuns / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+#if !defined(SMV_SIMD_AVX2) && !defined(SMV_SIMD_SSE2)
+    spdlog::info("Vertex packing: this build has no SIMD kernel, only the scalar loop is measured");
+#endif
+    const VertexTransform *const bakes[] = {nullptr, &transform};
+    for (const VertexTransform *bake : bakes)
+    {
+        VertexPackParams params;
+        params.transform = bake;
+        double scalar = verticesPerSecond(PackVertices<VertexFormat::Float, kAllVertexAttributes, false>, scalarOut, params);
+#if defined(SMV_SIMD_AVX2) || defined(SMV_SIMD_SSE2)
+        double vectorized = verticesPerSecond(PackVertices<VertexFormat::Float, kAllVertexAttributes, true>, vectorOut, params);
+        spdlog::info("Vertex packing{}: scalar {:.1f} M vertices/s, SSE2 {:.1f} M vertices/s ({:.2f}x)", bake ? " with node transform" : "",
+                     scalar * 1e-6, vectorized * 1e-6, vectorized / scalar);
+        // Transformed results match too, since the build disables multiply-add contraction (see CMakeLists.txt)
+        if (scalarOut != vectorOut)
+            spdlog::error("Vectorized vertex packing does not match the scalar result");
+#else
+        spdlog::info("Vertex packing{}: scalar {:.1f} M vertices/s", bake ? " with node transform" : "", scalar * 1e-6);
+#endif
+    }
+}
+
+// Packs 'streams' with the vectorized and the scalar float packer and compares the output byte for byte, including bytes
+// around it that neither may touch. The vectorized packer also packs the mesh in kPackRangeSize ranges, the way
+// PackMeshVertices splits large meshes: into one buffer, and each range into a buffer of its own. Ranges are packed last
+// to first, so a store spilling past the end of a range would clobber the range after it.
+template <uint32_t Attributes>
+bool SelfTestPackedLayout(const VertexStreams &streams, const VertexPackParams &params, const char *source)
+{
+    constexpr VertexLayout layout{VertexFormat::Float, Attributes};
+    constexpr size_t kGuardBytes = 64;
+    const unsigned int count = streams.vertexCount;
+    std::vector<unsigned char> scalar(count * layout.stride() + kGuardBytes, 0xCD);
+    std::vector<unsigned char> whole(scalar), split(scalar), ranged(scalar);
+    PackVertices<VertexFormat::Float, Attributes, false>(streams, 0, count, scalar.data(), params);
+    PackVertices<VertexFormat::Float, Attributes, true>(streams, 0, count, whole.data(), params);
+    for (unsigned int range = (count + kPackRangeSize - 1) / kPackRangeSize; range-- > 0;)
+    {
+        const unsigned int first = range * kPackRangeSize;
+        const unsigned int end = std::min(first + kPackRangeSize, count);
+        PackVertices<VertexFormat::Float, Attributes, true>(streams, first, end, split.data(), params);
+        PackVertices<VertexFormat::Float, Attributes, true>(VertexStreamRange(streams, first, end), 0, end - first,
+                                                            ranged.data() + static_cast<size_t>(first) * layout.stride(), params);
+    }
+    const bool matches = whole == scalar && split == scalar && ranged == scalar;
+    if (!matches)
+        spdlog::error("Self-test: vectorized vertex packing differs from the scalar loop ({} vertices, {}, attributes {}{})", count,
+                      source, Attributes, params.transform ? ", with node transform" : "");
+    return matches;
+}
+
+// Checks the vectorized float vertex packing against the scalar loop (--self-test): every attribute subset, with and
+// without a node transform, for meshes of 0, 1 and 2 vertices and meshes split at a kPackRangeSize boundary, from
+// Assimp's separate arrays, from a strided glTF-style interleaved buffer and from sources missing attributes.
+// Returns false on any mismatch.
+bool SelfTestVertexPacking()
+{
+#if !defined(SMV_SIMD_AVX2) && !defined(SMV_SIMD_SSE2)
+    spdlog::info("Self-test: this build has no SIMD kernel, the vectorized packer is the scalar loop");
+#endif
+    VertexTransform transform;
+    transform.position = glm::rotate(glm::scale(glm::mat4(1.0f), glm::vec3(2.0f, 0.5f, 1.0f)), 0.5f, glm::vec3(0.0f, 1.0f, 0.0f));
+    transform.position[3] = glm::vec4(1.0f, -2.0f, 3.0f, 1.0f);
+    transform.normal = glm::transpose(glm::inverse(glm::mat3(transform.position)));
+    auto value = [](unsigned int v, unsigned int component)
+    { return std::sin(static_cast<float>(v * 7 + component) * 0.37f) * 10.0f; };
+
+    const VertexTransform *const bakes[] = {nullptr, &transform};
+    bool passed = true;
+    size_t cases = 0;
+    for (unsigned int count : {0u, 1u, 2u, kPackRangeSize + 1, kPackRangeSize + 2})
+    {
+        // Assimp: one tightly packed array per attribute, sized exactly, so a sanitizer catches reads past the end
+        std::vector<float> positions(count * 3), normals(count * 3), colors(count * 4), texCoords(count * 3);
+        // glTF-style: one buffer interleaving position, normal, UV and color (12 floats per vertex)
+        constexpr size_t kInterleavedFloats = 12;
+        std::vector<float> interleaved(count * kInterleavedFloats);
+        for (unsigned int v = 0; v < count; ++v)
+        {
+            for (unsigned int c = 0; c < kInterleavedFloats; ++c)
+                interleaved[v * kInterleavedFloats + c] = value(v, c);
+            if (v % 7 == 3) // Zero normals stay zero under a transform
+                std::fill_n(&interleaved[v * kInterleavedFloats + 3], 3, 0.0f);
+            std::copy_n(&interleaved[v * kInterleavedFloats], 3, &positions[v * 3]);
+            std::copy_n(&interleaved[v * kInterleavedFloats + 3], 3, &normals[v * 3]);
+            std::copy_n(&interleaved[v * kInterleavedFloats + 6], 2, &texCoords[v * 3]);
+            std::copy_n(&interleaved[v * kInterleavedFloats + 8], 4, &colors[v * 4]);
+        }
+        auto bytes = [count](const std::vector<float> &data)
+        { return count == 0 ? nullptr : reinterpret_cast<const unsigned char *>(data.data()); };
+
+        VertexStreams assimp;
+        assimp.vertexCount = count;
+        assimp.positions = bytes(positions), assimp.positionStep = 3 * sizeof(float);
+        assimp.normals = bytes(normals), assimp.normalStep = 3 * sizeof(float);
+        assimp.colors = bytes(colors), assimp.colorStep = 4 * sizeof(float);
+        assimp.texCoords = bytes(texCoords), assimp.texCoordStep = 3 * sizeof(float);
+        VertexStreams strided;
+        strided.vertexCount = count;
+        const unsigned char *base = bytes(interleaved);
+        strided.positions = base, strided.normals = base ? base + 3 * sizeof(float) : nullptr;
+        strided.texCoords = base ? base + 6 * sizeof(float) : nullptr, strided.colors = base ? base + 8 * sizeof(float) : nullptr;
+        strided.positionStep = strided.normalStep = strided.texCoordStep = strided.colorStep = kInterleavedFloats * sizeof(float);
+        VertexStreams sparse = assimp; // Default normal, default color and zero UVs
+        sparse.normals = sparse.colors = sparse.texCoords = nullptr;
+        sparse.normalStep = sparse.colorStep = sparse.texCoordStep = 0;
+
+        const std::pair<const VertexStreams *, const char *> sources[] = {{&assimp, "Assimp arrays"}, {&strided, "strided glTF buffer"},
+                                                                          {&sparse, "missing attributes"}};
+        for (const auto &[streams, name] : sources)
+        {
+            for (const VertexTransform *bake : bakes)
+            {
+                VertexPackParams params;
+                params.defaultColor = glm::vec3(0.25f, 0.5f, 0.75f);
+                params.transform = bake;
+                static_assert(kAllVertexAttributes == 3, "One check per attribute subset");
+                passed = SelfTestPackedLayout<0>(*streams, params, name) && passed;
+                passed = SelfTestPackedLayout<1>(*streams, params, name) && passed;
+                passed = SelfTestPackedLayout<2>(*streams, params, name) && passed;
+                passed = SelfTestPackedLayout<3>(*streams, params, name) && passed;
+                cases += 4;
+            }
+        }
+    }
+    if (passed)
+        spdlog::info("Self-test: vectorized vertex packing matches the scalar loop in all {} cases", cases);
+    return passed;
+}
+
+// Packs the indices of faces [begin, end) back to back into 'out' (32-bit, or 16-bit for meshes of at most
+// kMaxShortIndexVertices vertices) and returns how many there were. Only pure triangle meshes, whose faces all have
+// three indices, can be packed into one buffer in several ranges.
+template <typename Index>
+size_t packMeshIndices(const aiMesh *mesh_ptr, unsigned int begin, unsigned int end, Index *out)
+{
+    size_t count = 0;
+    for (unsigned int f = begin; f < end; f++)
+    {
+        const aiFace &face = mesh_ptr->mFaces[f];
+        for (unsigned int j = 0; j < face.mNumIndices; j++)
+            out[count++] = static_cast<Index>(face.mIndices[j]);
+    }
+    return count;
+}
+
+// Receives the packed vertices of a mesh a range at a time (first vertex, bytes), in no particular order; called on pool threads
+using PackedVertexSink = std::function<void(size_t mesh, unsigned int begin, const unsigned char *data, size_t bytes)>;
+
+// Packs the vertices of meshes [first, last) of a model from their source streams into the vertex storage the caller sized,
+// or, given the mapped geometry arena, straight into it at each mesh's arenaVertexOffset. With 'alsoTo', arena ranges are
+// packed once into a scratch buffer instead and copied both into the mapping (which cannot be read back) and to the sink.
+// Large meshes are split into ranges so a single huge mesh still spreads over all cores; each task writes to its own slice,
+// so the result does not depend on scheduling. Meshes no node references are skipped, and meshes whose vertices already
+// point elsewhere (source data in the layout) only get their bounds. Returns false if the load was cancelled.
+bool PackMeshVertices(ModelData &model, size_t first, size_t last, const std::vector<VertexStreams> &streams,
+                      const std::vector<const VertexTransform *> &bakes, const glm::vec3 &defaultColor,
+                      unsigned char *arenaVertices, const PackedVertexSink &alsoTo, LoadCancelToken cancel)
+{
+    struct PackRange
+    {
+        size_t mesh;
+        unsigned int begin, end;
+        glm::vec3 boundsMin, boundsMax; // Bounds of the range, merged per mesh afterwards
+    };
+    std::vector<PackRange> ranges;
+    for (size_t i = first; i < last; ++i)
+    {
+        if (model.meshes[i].instanceCount == 0)
+            continue;
+        for (unsigned int v = 0; v < streams[i].vertexCount; v += kPackRangeSize)
+            ranges.push_back({i, v, std::min(v + kPackRangeSize, streams[i].vertexCount), {}, {}});
+    }
+
+    // Bounds come first: the compact format quantizes positions against them
+    WorkerPool &pool = GetWorkerPool();
+    pool.parallelFor(ranges.size(), [&](size_t r)
+                     {
+        if (cancel.cancelled())
+            return;
+        PackRange &range = ranges[r];
+        const VertexStreams &source = streams[range.mesh];
+        range.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+        range.boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+        for (unsigned int v = range.begin; v < range.end; ++v)
+        {
+            glm::vec3 p = TransformedPosition(LoadFloat3(source.positions + v * source.positionStep), bakes[range.mesh]);
+            range.boundsMin = glm::min(range.boundsMin, p);
+            range.boundsMax = glm::max(range.boundsMax, p);
+        } });
+    if (cancel.cancelled())
+        return false;
+
+    // Merge range bounds in range order
+    std::vector<bool> hasBounds(last - first, false);
+    for (const PackRange &range : ranges)
+    {
+        MeshData &meshData = model.meshes[range.mesh];
+        const bool merge = hasBounds[range.mesh - first];
+        meshData.boundsMin = merge ? glm::min(meshData.boundsMin, range.boundsMin) : range.boundsMin;
+        meshData.boundsMax = merge ? glm::max(meshData.boundsMax, range.boundsMax) : range.boundsMax;
+        hasBounds[range.mesh - first] = true;
+    }
+
+    pool.parallelFor(ranges.size(), [&](size_t r)
+                     {
+        if (cancel.cancelled())
+            return;
+        const PackRange &range = ranges[r];
+        MeshData &meshData = model.meshes[range.mesh];
+        unsigned char *out = meshData.inArena ? arenaVertices + meshData.arenaVertexOffset : meshData.vertexStorage.data();
+        if (!meshData.inArena && meshData.vertices != meshData.vertexStorage.data())
+            return; // Used in place
+        const VertexPackParams params{meshData.boundsMin, meshData.boundsMax, defaultColor, bakes[range.mesh]};
+        if (meshData.inArena && alsoTo)
+        {
+            const size_t bytes = static_cast<size_t>(range.end - range.begin) * meshData.layout.stride();
+            std::unique_ptr<unsigned char[]> scratch(new unsigned char[bytes]);
+            VertexPacker(meshData.layout)(VertexStreamRange(streams[range.mesh], range.begin, range.end), 0, range.end - range.begin,
+                                          scratch.get(), params);
+            std::memcpy(out + static_cast<size_t>(range.begin) * meshData.layout.stride(), scratch.get(), bytes);
+            alsoTo(range.mesh, range.begin, scratch.get(), bytes);
+            return;
+        }
+        VertexPacker(meshData.layout)(streams[range.mesh], range.begin, range.end, out, params); });
+    return !cancel.cancelled();
+}
+
+// --- Vertex cache / overdraw optimization ---
+// Optional post-packing pass over triangle meshes: Forsyth-style triangle ordering for the post-transform cache,
+// optional cluster sorting against overdraw (Tipsify-style), then vertex reordering by first use for fetch locality.
+
+// Position of vertex v, dequantized for the compact format
+glm::vec3 VertexPosition(const MeshData &mesh, size_t v)
+{
+    const unsigned char *vertex = static_cast<const unsigned char *>(mesh.vertices) + v * mesh.layout.stride(); // Position comes first
+    if (mesh.layout.format == VertexFormat::Compact)
+    {
+        uint16_t position[3];
+        std::memcpy(position, vertex, sizeof(position));
+        glm::vec3 unit(position[0] / 65535.0f, position[1] / 65535.0f, position[2] / 65535.0f);
+        return mesh.boundsMin + unit * (mesh.boundsMax - mesh.boundsMin);
+    }
+    float position[3];
+    std::memcpy(position, vertex, sizeof(position));
+    return glm::vec3(position[0], position[1], position[2]);
+}
+
+// Source position p as the mesh's layout stores it, i.e. what VertexPosition returns once p has been packed
+glm::vec3 StoredPosition(const MeshData &mesh, const glm::vec3 &p)
+{
+    if (mesh.layout.format != VertexFormat::Compact)
+        return p;
+    uint16_t position[4];
+    QuantizePosition(p, mesh.boundsMin, PositionQuantizationScale(mesh.boundsMin, mesh.boundsMax), position);
+    glm::vec3 unit(position[0] / 65535.0f, position[1] / 65535.0f, position[2] / 65535.0f);
+    return mesh.boundsMin + unit * (mesh.boundsMax - mesh.boundsMin);
+}
+
+// Post-transform cache statistics of an index buffer, simulated with a FIFO cache
+struct VertexCacheStats
+{
+    size_t triangles = 0;
+    size_t vertices = 0; // Distinct vertices referenced
+    size_t misses = 0;
+
+    float acmr() const { return triangles ? float(misses) / float(triangles) : 0.0f; } // Average cache miss ratio: misses per triangle
+    float atvr() const { return vertices ? float(misses) / float(vertices) : 0.0f; }   // Average transformed vertex ratio: 1.0 is optimal
+
+    VertexCacheStats &operator+=(const VertexCacheStats &other)
+    {
+        triangles += other.triangles;
+        vertices += other.vertices;
+        misses += other.misses;
+        return *this;
+    }
+};
+
+constexpr unsigned int kStatsCacheSize = 16; // FIFO size for the statistics, typical of current GPUs
+
+VertexCacheStats AnalyzeVertexCache(const unsigned int *indices, size_t indexCount, size_t vertexCount,
+                                    unsigned int cacheSize = kStatsCacheSize)
+{
+    VertexCacheStats stats;
+    stats.triangles = indexCount / 3;
+    std::vector<size_t> timestamps(vertexCount, 0); // Value of 'time' when the vertex last entered the cache, 0 = never
+    size_t time = cacheSize + 1;
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        unsigned int v = indices[i];
+        if (timestamps[v] == 0)
+            stats.vertices++;
+        if (time - timestamps[v] > cacheSize)
+        {
+            timestamps[v] = time++;
+            stats.misses++;
+        }
+    }
+    return stats;
+}
+
+// Reorders triangles for post-transform cache locality (Tom Forsyth, "Linear-Speed Vertex Cache Optimisation")
+void OptimizeVertexCache(std::vector<unsigned int> &indices, size_t vertexCount)
+{
+    constexpr int kCacheSize = 32; // Modelled LRU cache size
+    const size_t triCount = indices.size() / 3;
+    if (triCount == 0)
+        return;
+
+    // Score tables: cache position (LRU, the last triangle's vertices get a fixed score) and remaining valence
+    float cacheScores[kCacheSize];
+    for (int i = 0; i < kCacheSize; ++i)
+        cacheScores[i] = i < 3 ? 0.75f : std::pow(1.0f - float(i - 3) / float(kCacheSize - 3), 1.5f);
+    float valenceScores[32];
+    for (int i = 1; i < 32; ++i)
+        valenceScores[i] = 2.0f / std::sqrt(float(i));
+    valenceScores[0] = 0.0f;
+    auto vertexScore = [&](int cachePos, unsigned int remaining)
+    {
+        if (remaining == 0)
+            return -1.0f; // No triangles left to use this vertex
+        float score = cachePos >= 0 ? cacheScores[cachePos] : 0.0f;
+        return score + (remaining < 32 ? valenceScores[remaining] : 2.0f / std::sqrt(float(remaining)));
+    };
+
+    // Vertex -> triangle adjacency; the first 'remaining[v]' entries of each list are the triangles not yet emitted
+    std::vector<unsigned int> remaining(vertexCount, 0);
+    for (unsigned int v : indices)
+        remaining[v]++;
+    std::vector<size_t> adjacencyOffset(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v)
+        adjacencyOffset[v + 1] = adjacencyOffset[v] + remaining[v];
+    std::vector<unsigned int> adjacency(indices.size());
+    {
+        std::vector<size_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+        for (size_t t = 0; t < triCount; ++t)
+            for (int k = 0; k < 3; ++k)
+                adjacency[fill[indices[t * 3 + k]]++] = static_cast<unsigned int>(t);
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> scores(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+        scores[v] = vertexScore(-1, remaining[v]);
+    std::vector<float> triScores(triCount);
+    for (size_t t = 0; t < triCount; ++t)
+        triScores[t] = scores[indices[t * 3]] + scores[indices[t * 3 + 1]] + scores[indices[t * 3 + 2]];
+    std::vector<bool> emitted(triCount, false);
+
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+    std::vector<unsigned int> cache, newCache;
+    cache.reserve(kCacheSize + 3);
+    newCache.reserve(kCacheSize + 3);
+
+    size_t best = std::max_element(triScores.begin(), triScores.end()) - triScores.begin();
+    size_t cursor = 0; // Fallback scan position for when the cache holds no live triangles
+    for (size_t emittedCount = 0; emittedCount < triCount; ++emittedCount)
+    {
+        if (best == triCount)
+        {
+            // Dead end: continue with the next triangle in input order
+            while (emitted[cursor])
+                cursor++;
+            best = cursor;
+        }
+
+        const unsigned int *tri = &indices[best * 3];
+        emitted[best] = true;
+        newCache.clear();
+        for (int k = 0; k < 3; ++k)
+        {
+            unsigned int v = tri[k];
+            output.push_back(v);
+            newCache.push_back(v);
+            // Drop the triangle from the vertex's live list
+            unsigned int *list = &adjacency[adjacencyOffset[v]];
+            unsigned int *end = list + remaining[v];
+            *std::find(list, end, static_cast<unsigned int>(best)) = end[-1];
+            remaining[v]--;
+        }
+        for (unsigned int v : cache)
+            if (v != tri[0] && v != tri[1] && v != tri[2])
+                newCache.push_back(v);
+
+        // Rescore every vertex whose cache position changed, including the ones that fell out
+        for (size_t i = 0; i < newCache.size(); ++i)
+        {
+            unsigned int v = newCache[i];
+            cachePosition[v] = i < size_t(kCacheSize) ? int(i) : -1;
+            scores[v] = vertexScore(cachePosition[v], remaining[v]);
+        }
+        if (newCache.size() > size_t(kCacheSize))
+            newCache.resize(kCacheSize);
+        std::swap(cache, newCache);
+
+        // The next triangle is the best one touching the cache
+        best = triCount;
+        float bestScore = -1.0f;
+        for (unsigned int v : cache)
+        {
+            const unsigned int *list = &adjacency[adjacencyOffset[v]];
+            for (unsigned int j = 0; j < remaining[v]; ++j)
+            {
+                unsigned int t = list[j];
+                const unsigned int *ti = &indices[size_t(t) * 3];
+                triScores[t] = scores[ti[0]] + scores[ti[1]] + scores[ti[2]];
+                if (triScores[t] > bestScore)
+                {
+                    bestScore = triScores[t];
+                    best = t;
+                }
+            }
+        }
+    }
+    indices.swap(output);
+}
+
+// Reorders clusters of a cache-optimized index buffer so that outward-facing, outer clusters are drawn first.
+// Clusters are split where the simulated cache restarts (all three vertices miss), so the order between them
+// barely affects the cache efficiency (Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw").
+void OptimizeOverdraw(std::vector<unsigned int> &indices, const MeshData &mesh)
+{
+    const size_t triCount = indices.size() / 3;
+    std::vector<size_t> clusterStart;
+    {
+        std::vector<size_t> timestamps(mesh.vertexCount, 0);
+        size_t time = kStatsCacheSize + 1;
+        for (size_t t = 0; t < triCount; ++t)
+        {
+            int misses = 0;
+            for (int k = 0; k < 3; ++k)
+            {
+                unsigned int v = indices[t * 3 + k];
+                if (time - timestamps[v] > kStatsCacheSize)
+                {
+                    timestamps[v] = time++;
+                    misses++;
+                }
+            }
+            if (t == 0 || misses == 3)
+                clusterStart.push_back(t);
+        }
+    }
+    if (clusterStart.size() < 2)
+        return;
+    clusterStart.push_back(triCount);
+
+    // Area-weighted centroid and normal per cluster
+    const size_t clusterCount = clusterStart.size() - 1;
+    std::vector<glm::vec3> centroids(clusterCount, glm::vec3(0.0f)), normals(clusterCount, glm::vec3(0.0f));
+    std::vector<float> areas(clusterCount, 0.0f);
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t c = 0; c < clusterCount; ++c)
+    {
+        for (size_t t = clusterStart[c]; t < clusterStart[c + 1]; ++t)
+        {
+            glm::vec3 p0 = VertexPosition(mesh, indices[t * 3]);
+            glm::vec3 p1 = VertexPosition(mesh, indices[t * 3 + 1]);
+            glm::vec3 p2 = VertexPosition(mesh, indices[t * 3 + 2]);
+            glm::vec3 n = glm::cross(p1 - p0, p2 - p0); // Length is twice the area
+            float area = glm::length(n);
+            centroids[c] += (p0 + p1 + p2) * (area / 3.0f);
+            normals[c] += n;
+            areas[c] += area;
+        }
+        meshCentroid += centroids[c];
+        meshArea += areas[c];
+    }
+    if (meshArea <= 0.0f)
+        return;
+    meshCentroid /= meshArea;
+
+    // Clusters far out along their own normal are likely to occlude the rest
+    std::vector<float> sortKeys(clusterCount, 0.0f);
+    for (size_t c = 0; c < clusterCount; ++c)
+    {
+        float normalLength = glm::length(normals[c]);
+        if (areas[c] > 0.0f && normalLength > 0.0f)
+            sortKeys[c] = glm::dot(centroids[c] / areas[c] - meshCentroid, normals[c] / normalLength);
+    }
+    std::vector<size_t> order(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c)
+        order[c] = c;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+                     { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+    for (size_t c : order)
+        output.insert(output.end(), indices.begin() + clusterStart[c] * 3, indices.begin() + clusterStart[c + 1] * 3);
+    indices.swap(output);
+}
+
+// Renumbers vertices in order of first use so vertex fetches walk the buffer linearly; unreferenced vertices are dropped
+void OptimizeVertexFetch(MeshData &mesh)
+{
+    const size_t stride = mesh.layout.stride();
+    std::vector<unsigned int> remap(mesh.vertexCount, ~0u);
+    std::vector<unsigned char> reordered(mesh.vertexCount * stride);
+    const unsigned char *source = static_cast<const unsigned char *>(mesh.vertices);
+    unsigned int next = 0;
+    for (unsigned int &index : mesh.indexStorage)
+    {
+        if (remap[index] == ~0u)
+        {
+            std::memcpy(reordered.data() + size_t(next) * stride, source + size_t(index) * stride, stride);
+            remap[index] = next++;
+        }
+        index = remap[index];
+    }
+    reordered.resize(size_t(next) * stride);
+    mesh.vertexStorage.swap(reordered);
+    mesh.vertices = mesh.vertexStorage.data();
+    mesh.vertexCount = next;
+}
+
+// Runs the optimization pass on a freshly packed triangle mesh; returns the cache statistics before and after
+std::pair<VertexCacheStats, VertexCacheStats> optimizeMeshData(MeshData &mesh, bool optimizeOverdraw)
+{
+    std::pair<VertexCacheStats, VertexCacheStats> stats;
+    stats.first = AnalyzeVertexCache(mesh.indexStorage.data(), mesh.indexStorage.size(), mesh.vertexCount);
+    OptimizeVertexCache(mesh.indexStorage, mesh.vertexCount);
+    if (optimizeOverdraw)
+        OptimizeOverdraw(mesh.indexStorage, mesh);
+    OptimizeVertexFetch(mesh);
+    mesh.indices = mesh.indexStorage.data();
+    mesh.indexCount = mesh.indexStorage.size();
+    stats.second = AnalyzeVertexCache(mesh.indexStorage.data(), mesh.indexStorage.size(), mesh.vertexCount);
+    return stats;
+}
+
+// --- 16-bit indices and spatial chunking ---
+constexpr size_t kMaxShortIndexVertices = 65536; // Vertices addressable by GL_UNSIGNED_SHORT indices
+
+// Recomputes a freshly packed mesh's bounds from its vertices; compact positions are requantized against the new bounds
+void FitMeshBounds(MeshData &mesh)
+{
+    std::vector<glm::vec3> positions(mesh.vertexCount);
+    glm::vec3 boundsMin(std::numeric_limits<float>::max()), boundsMax(std::numeric_limits<float>::lowest());
+    for (size_t v = 0; v < mesh.vertexCount; ++v)
+    {
+        positions[v] = VertexPosition(mesh, v);
+        boundsMin = glm::min(boundsMin, positions[v]);
+        boundsMax = glm::max(boundsMax, positions[v]);
+    }
+    if (mesh.vertexCount == 0)
+        return;
+    if (mesh.layout.format == VertexFormat::Compact)
+    {
+        const size_t stride = mesh.layout.stride();
+        glm::vec3 toUnit = PositionQuantizationScale(boundsMin, boundsMax);
+        for (size_t v = 0; v < mesh.vertexCount; ++v)
+        {
+            uint16_t quantized[4];
+            QuantizePosition(positions[v], boundsMin, toUnit, quantized);
+            std::memcpy(mesh.vertexStorage.data() + v * stride, quantized, sizeof(quantized));
+        }
+    }
+    mesh.boundsMin = boundsMin;
+    mesh.boundsMax = boundsMax;
+}
+
+// Splits a freshly packed triangle mesh into spatially coherent chunks whose vertices fit 16-bit indices.
+// Triangles are bisected at the median centroid along the longest axis until every chunk fits; each chunk
+// keeps the input triangle order (so an optimized order survives) and gets its own vertices and bounds.
+std::vector<MeshData> splitMeshChunks(const MeshData &mesh)
+{
+    const size_t triCount = mesh.indexStorage.size() / 3;
+    const unsigned int *indices = mesh.indexStorage.data();
+    std::vector<glm::vec3> centroids(triCount);
+    for (size_t t = 0; t < triCount; ++t)
+        centroids[t] = (VertexPosition(mesh, indices[t * 3]) + VertexPosition(mesh, indices[t * 3 + 1]) +
+                        VertexPosition(mesh, indices[t * 3 + 2])) /
+                       3.0f;
+
+    std::vector<unsigned int> tris(triCount);
+    for (size_t t = 0; t < triCount; ++t)
+        tris[t] = static_cast<unsigned int>(t);
+    std::vector<size_t> seen(mesh.vertexCount, 0); // Last pass that counted the vertex
+    size_t pass = 0;
+    std::vector<std::pair<size_t, size_t>> pending{{0, triCount}}, leaves;
+    while (!pending.empty())
+    {
+        auto [begin, end] = pending.back();
+        pending.pop_back();
+
+        size_t uniqueVertices = 0;
+        ++pass;
+        glm::vec3 centroidMin(std::numeric_limits<float>::max()), centroidMax(std::numeric_limits<float>::lowest());
+        for (size_t i = begin; i < end; ++i)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                unsigned int v = indices[size_t(tris[i]) * 3 + k];
+                if (seen[v] != pass)
+                {
+                    seen[v] = pass;
+                    uniqueVertices++;
+                }
+            }
+            centroidMin = glm::min(centroidMin, centroids[tris[i]]);
+            centroidMax = glm::max(centroidMax, centroids[tris[i]]);
+        }
+        if (uniqueVertices <= kMaxShortIndexVertices)
+        {
+            leaves.emplace_back(begin, end);
+            continue;
+        }
+
+        glm::vec3 extent = centroidMax - centroidMin;
+        int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+        size_t mid = begin + (end - begin) / 2;
+        std::nth_element(tris.begin() + begin, tris.begin() + mid, tris.begin() + end, [&](unsigned int a, unsigned int b)
+                         { return centroids[a][axis] < centroids[b][axis] || (centroids[a][axis] == centroids[b][axis] && a < b); });
+        std::sort(tris.begin() + begin, tris.begin() + mid); // Back to input order within each half
+        std::sort(tris.begin() + mid, tris.begin() + end);
+        pending.emplace_back(mid, end); // Left half is processed first, so chunks come out in spatial order
+        pending.emplace_back(begin, mid);
+    }
+
+    const size_t stride = mesh.layout.stride();
+    const unsigned char *source = static_cast<const unsigned char *>(mesh.vertices);
+    std::vector<unsigned int> remap(mesh.vertexCount);
+    std::vector<MeshData> chunks(leaves.size());
+    for (size_t c = 0; c < leaves.size(); ++c)
+    {
+        MeshData &chunk = chunks[c];
+        chunk.layout = mesh.layout;
+        chunk.materialIndex = mesh.materialIndex;
+        chunk.firstInstance = mesh.firstInstance;
+        chunk.instanceCount = mesh.instanceCount;
+        chunk.boundsMin = mesh.boundsMin; // What compact positions are quantized against until FitMeshBounds
+        chunk.boundsMax = mesh.boundsMax;
+        ++pass;
+        unsigned int next = 0;
+        for (size_t i = leaves[c].first; i < leaves[c].second; ++i)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                unsigned int v = indices[size_t(tris[i]) * 3 + k];
+                if (seen[v] != pass)
+                {
+                    seen[v] = pass;
+                    remap[v] = next++;
+                    chunk.vertexStorage.insert(chunk.vertexStorage.end(), source + size_t(v) * stride, source + size_t(v + 1) * stride);
+                }
+                chunk.indexStorage.push_back(remap[v]);
+            }
+        }
+        chunk.vertices = chunk.vertexStorage.data();
+        chunk.vertexCount = next;
+        chunk.indices = chunk.indexStorage.data();
+        chunk.indexCount = chunk.indexStorage.size();
+        FitMeshBounds(chunk);
+    }
+    return chunks;
+}
+
+// Switches a freshly packed mesh to 16-bit indices when its vertex count allows (16-bit source indices stay where they are)
+void narrowIndices(MeshData &mesh)
+{
+    if (mesh.vertexCount > kMaxShortIndexVertices || mesh.indexSize == sizeof(uint16_t))
+        return;
+    mesh.shortIndexStorage.assign(mesh.indexStorage.begin(), mesh.indexStorage.end());
+    std::vector<unsigned int>().swap(mesh.indexStorage);
+    mesh.indices = mesh.shortIndexStorage.data();
+    mesh.indexSize = sizeof(uint16_t);
+}
+
+// --- Level of detail ---
+// Coarser index buffers over a mesh's own vertices, made by quadric-error edge collapses (Garland-Heckbert).
+// Every collapse moves a vertex onto one of its neighbours, so all levels share the vertex buffer and each level is
+// just another range of the index buffer. Vertices on open borders (including chunk borders and attribute seams,
+// where vertices are split) never move, so levels stay watertight against their neighbours.
+
+constexpr size_t kMinLodTriangles = 64; // Meshes (or levels) smaller than this are not simplified further
+
+// Sum of squared distances to a set of planes, weighted by triangle area
+struct Quadric
+{
+    double m[10] = {}; // Upper triangle of the symmetric 4x4 plane matrix: aa ab ac ad bb bc bd cc cd dd
+    double weight = 0;
+
+    static Quadric fromTriangle(const glm::vec3 &p0, const glm::vec3 &p1, const glm::vec3 &p2)
+    {
+        Quadric q;
+        glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+        float length = glm::length(n);
+        if (length == 0.0f)
+            return q;
+        n /= length;
+        const double plane[4] = {n.x, n.y, n.z, -glm::dot(n, p0)};
+        const double area = length * 0.5;
+        int k = 0;
+        for (int i = 0; i < 4; ++i)
+            for (int j = i; j < 4; ++j)
+                q.m[k++] = plane[i] * plane[j] * area;
+        q.weight = area;
+        return q;
+    }
+
+    Quadric &operator+=(const Quadric &o)
+    {
+        for (int k = 0; k < 10; ++k)
+            m[k] += o.m[k];
+        weight += o.weight;
+        return *this;
+    }
+
+    // Mean squared distance of p to the planes
+    double error(const glm::vec3 &p) const
+    {
+        const double v[4] = {p.x, p.y, p.z, 1.0};
+        double e = 0.0;
+        int k = 0;
+        for (int i = 0; i < 4; ++i)
+            for (int j = i; j < 4; ++j)
+                e += m[k++] * v[i] * v[j] * (i == j ? 1.0 : 2.0);
+        return weight > 0 ? std::max(e, 0.0) / weight : 0.0;
+    }
+};
+
+// Collapses edges of 'indices' until at most targetIndexCount remain or no valid collapse is left.
+// 'quadrics' carry over between calls so successive levels keep accumulating error. Returns the largest collapse
+// error (as a distance) spent.
+float SimplifyIndices(std::vector<unsigned int> &indices, size_t targetIndexCount, const std::vector<glm::vec3> &positions,
+                      std::vector<Quadric> &quadrics, const std::vector<uint8_t> &locked)
+{
+    const size_t vertexCount = positions.size();
+    std::vector<unsigned int> remap(vertexCount), adjacencyStart(vertexCount + 1), adjacency;
+    std::vector<uint8_t> touched(vertexCount);
+    struct Collapse
+    {
+        unsigned int from, to;
+        float cost;
+    };
+    std::vector<Collapse> collapses;
+    double maxError = 0.0;
+
+    for (int pass = 0; pass < 64 && indices.size() > targetIndexCount; ++pass)
+    {
+        // Triangles around every vertex
+        std::fill(adjacencyStart.begin(), adjacencyStart.end(), 0);
+        for (unsigned int v : indices)
+            adjacencyStart[v + 1]++;
+        for (size_t v = 0; v < vertexCount; ++v)
+            adjacencyStart[v + 1] += adjacencyStart[v];
+        adjacency.resize(indices.size());
+        std::vector<unsigned int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+        for (size_t i = 0; i < indices.size(); ++i)
+            adjacency[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+
+        // Candidate collapses along every edge, in both directions, cheapest first
+        collapses.clear();
+        for (size_t t = 0; t < indices.size(); t += 3)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                unsigned int a = indices[t + k], b = indices[t + (k + 1) % 3];
+                Quadric q = quadrics[a];
+                q += quadrics[b];
+                if (!locked[a])
+                    collapses.push_back({a, b, static_cast<float>(q.error(positions[b]))});
+                if (!locked[b])
+                    collapses.push_back({b, a, static_cast<float>(q.error(positions[a]))});
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &x, const Collapse &y)
+                  { return x.cost < y.cost; });
+
+        // Apply the cheapest independent collapses; each removes about two triangles
+        for (size_t v = 0; v < vertexCount; ++v)
+            remap[v] = static_cast<unsigned int>(v);
+        std::fill(touched.begin(), touched.end(), 0);
+        const size_t wanted = (indices.size() - targetIndexCount) / 6 + 1;
+        size_t applied = 0;
+        for (const Collapse &collapse : collapses)
+        {
+            if (applied >= wanted)
+                break;
+            if (touched[collapse.from] || touched[collapse.to])
+                continue;
+            // Reject collapses that would flip a triangle around the moving vertex
+            bool flips = false;
+            const glm::vec3 &target = positions[collapse.to];
+            for (unsigned int i = adjacencyStart[collapse.from]; i < adjacencyStart[collapse.from + 1] && !flips; ++i)
+            {
+                const unsigned int *tri = &indices[size_t(adjacency[i]) * 3];
+                if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to)
+                    continue; // Degenerates and disappears
+                glm::vec3 p[3], q[3];
+                for (int k = 0; k < 3; ++k)
+                {
+                    p[k] = positions[tri[k]];
+                    q[k] = tri[k] == collapse.from ? target : p[k];
+                }
+                glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]), after = glm::cross(q[1] - q[0], q[2] - q[0]);
+                flips = glm::dot(before, after) <= 0.0f;
+            }
+            if (flips)
+                continue;
+
+            remap[collapse.from] = collapse.to;
+            // Freeze the neighbourhood for the rest of the pass, so the flip test above stays valid
+            for (unsigned int i = adjacencyStart[collapse.from]; i < adjacencyStart[collapse.from + 1]; ++i)
+                for (int k = 0; k < 3; ++k)
+                    touched[indices[size_t(adjacency[i]) * 3 + k]] = 1;
+            quadrics[collapse.to] += quadrics[collapse.from];
+            maxError = std::max(maxError, double(collapse.cost));
+            applied++;
+        }
+        if (applied == 0)
+            break;
+
+        // Rewrite the triangles and drop the ones that degenerated
+        size_t kept = 0;
+        for (size_t t = 0; t < indices.size(); t += 3)
+        {
+            unsigned int a = remap[indices[t]], b = remap[indices[t + 1]], c = remap[indices[t + 2]];
+            if (a == b || b == c || c == a)
+                continue;
+            indices[kept++] = a;
+            indices[kept++] = b;
+            indices[kept++] = c;
+        }
+        indices.resize(kept);
+    }
+    return static_cast<float>(std::sqrt(maxError));
+}
+
+// Appends coarser levels (about half the triangles each) to a freshly packed triangle mesh's indices and records
+// the ranges in mesh.lods. Levels that barely simplify are not kept.
+void GenerateMeshLods(MeshData &mesh, bool optimizeLevels)
+{
+    const size_t baseCount = mesh.indexStorage.size();
+    if (baseCount / 3 < kMinLodTriangles * 2)
+        return;
+    std::vector<glm::vec3> positions(mesh.vertexCount);
+    for (size_t v = 0; v < mesh.vertexCount; ++v)
+        positions[v] = VertexPosition(mesh, v);
+
+    std::vector<Quadric> quadrics(mesh.vertexCount);
+    for (size_t t = 0; t < baseCount; t += 3)
+    {
+        const unsigned int *tri = &mesh.indexStorage[t];
+        Quadric q = Quadric::fromTriangle(positions[tri[0]], positions[tri[1]], positions[tri[2]]);
+        for (int k = 0; k < 3; ++k)
+            quadrics[tri[k]] += q;
+    }
+
+    // Border edges are used by a single triangle; their vertices are locked
+    std::unordered_map<uint64_t, uint32_t> edgeUse;
+    edgeUse.reserve(baseCount);
+    auto edgeKey = [](unsigned int a, unsigned int b)
+    { return (uint64_t(std::min(a, b)) << 32) | std::max(a, b); };
+    for (size_t t = 0; t < baseCount; t += 3)
+        for (int k = 0; k < 3; ++k)
+            edgeUse[edgeKey(mesh.indexStorage[t + k], mesh.indexStorage[t + (k + 1) % 3])]++;
+    std::vector<uint8_t> locked(mesh.vertexCount, 0);
+    for (const auto &[key, uses] : edgeUse)
+    {
+        if (uses == 1)
+        {
+            locked[key >> 32] = 1;
+            locked[key & 0xFFFFFFFFu] = 1;
+        }
+    }
+
+    mesh.lods.push_back({0, baseCount, 0.0f});
+    std::vector<unsigned int> level(mesh.indexStorage.begin(), mesh.indexStorage.end());
+    float error = 0.0f;
+    while (mesh.lods.size() < kMaxMeshLods && level.size() / 3 >= kMinLodTriangles * 2)
+    {
+        const size_t previousCount = level.size();
+        error = std::max(error, SimplifyIndices(level, (previousCount / 6) * 3, positions, quadrics, locked));
+        if (level.size() > previousCount * 85 / 100)
+            break; // Mostly locked or out of valid collapses
+        if (optimizeLevels)
+            OptimizeVertexCache(level, mesh.vertexCount);
+        mesh.lods.push_back({mesh.indexStorage.size(), level.size(), error});
+        mesh.indexStorage.insert(mesh.indexStorage.end(), level.begin(), level.end());
+    }
+    if (mesh.lods.size() == 1)
+        mesh.lods.clear();
+    mesh.indices = mesh.indexStorage.data();
+    mesh.indexCount = mesh.indexStorage.size();
+}
+
+// Bounding sphere of a mesh's vertices (Ritter: a sphere through two far-apart vertices, grown to cover the rest).
+// Within a few percent of the minimal sphere and often much tighter than the AABB's circumscribed sphere.
+// 'position(v)' returns vertex v, so the sphere can be fitted to packed vertices or to the source they are packed from.
+template <typename PositionFn>
+void FitBoundingSphere(MeshData &mesh, PositionFn position)
+{
+    if (mesh.vertexCount == 0)
+        return;
+    auto farthestFrom = [&](const glm::vec3 &from)
+    {
+        glm::vec3 farthest = from;
+        float farthestDistance = -1.0f;
+        for (size_t v = 0; v < mesh.vertexCount; ++v)
+        {
+            glm::vec3 p = position(v);
+            float distance = glm::dot(p - from, p - from);
+            if (distance > farthestDistance)
+            {
+                farthestDistance = distance;
+                farthest = p;
+            }
+        }
+        return farthest;
+    };
+    glm::vec3 a = farthestFrom(position(0));
+    glm::vec3 b = farthestFrom(a);
+    glm::vec3 center = (a + b) * 0.5f;
+    float radius = glm::length(b - a) * 0.5f;
+    for (size_t v = 0; v < mesh.vertexCount; ++v)
+    {
+        glm::vec3 p = position(v);
+        float distance = glm::length(p - center);
+        if (distance > radius)
+        {
+            // Grow just enough to reach p, keeping the far side of the old sphere
+            float grown = (radius + distance) * 0.5f;
+            center += (p - center) * ((grown - radius) / distance);
+            radius = grown;
+        }
+    }
+    mesh.sphereCenter = center;
+    mesh.sphereRadius = radius;
+}
+
+void FitBoundingSphere(MeshData &mesh)
+{
+    FitBoundingSphere(mesh, [&](size_t v)
+                      { return VertexPosition(mesh, v); });
+}
+
+// Triangle budget of the occluders kept per model for software occlusion culling
+constexpr size_t kMaxOccluderTriangles = 65536;
+
+// Fills an occluder with the model-space positions and full-detail triangles of mesh 'index' of a list
+using OccluderExtractor = std::function<void(const MeshData &meshData, size_t index, Occluder &occluder)>;
+
+// Extracts an occluder from a mesh's packed vertices and indices
+void ExtractPackedOccluder(const MeshData &meshData, size_t /*index*/, Occluder &occluder)
+{
+    const size_t indexCount = meshData.lods.empty() ? meshData.indexCount : meshData.lods[0].indexCount; // Full detail
+    occluder.positions.resize(meshData.vertexCount);
+    for (size_t v = 0; v < meshData.vertexCount; ++v)
+        occluder.positions[v] = VertexPosition(meshData, v);
+    auto index = [&](size_t k) -> uint32_t
+    {
+        return meshData.indexSize == sizeof(uint16_t) ? static_cast<const uint16_t *>(meshData.indices)[k]
+                                                      : static_cast<const uint32_t *>(meshData.indices)[k];
+    };
+    occluder.indices.clear();
+    occluder.indices.reserve(indexCount);
+    for (size_t k = 0; k + 2 < indexCount; k += 3)
+    {
+        const uint32_t a = index(k), b = index(k + 1), c = index(k + 2);
+        if (a >= meshData.vertexCount || b >= meshData.vertexCount || c >= meshData.vertexCount)
+            continue; // Software occlusion looks positions up unchecked, so a damaged triangle is left out
+        occluder.indices.insert(occluder.indices.end(), {a, b, c});
+    }
+}
+
+// Keeps the meshes with the largest bounding boxes (by surface area) that fit the triangle budget, picking from
+// meshes[first, last) and the occluders picked before. Models packed batch by batch call this once per batch, while the
+// batch can still be read; only newly picked meshes are extracted. Instanced meshes are left out; they would count once per node.
+void SelectOccluders(const std::vector<MeshData> &meshes, size_t first, size_t last, const OccluderExtractor &extract,
+                     std::vector<Occluder> &occluders)
+{
+    constexpr size_t kNewCandidate = std::numeric_limits<size_t>::max();
+    struct Candidate
+    {
+        float surfaceArea;
+        size_t triangles;
+        size_t mesh;     // In 'meshes', for new candidates
+        size_t occluder; // In 'occluders' for earlier picks, kNewCandidate otherwise
+    };
+    std::vector<Candidate> candidates;
+    for (size_t k = 0; k < occluders.size(); ++k)
+        candidates.push_back({occluders[k].surfaceArea, occluders[k].indices.size() / 3, 0, k});
+    for (size_t i = first; i < last; ++i)
+    {
+        const MeshData &meshData = meshes[i];
+        if (meshData.instanceCount != 1 || meshData.indexCount < 3)
+            continue;
+        glm::vec3 size = meshData.boundsMax - meshData.boundsMin;
+        const size_t indexCount = meshData.lods.empty() ? meshData.indexCount : meshData.lods[0].indexCount;
+        candidates.push_back({size.x * size.y + size.y * size.z + size.z * size.x, indexCount / 3, i, kNewCandidate});
+    }
+    std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b)
+                     { return a.surfaceArea > b.surfaceArea; });
+
+    std::vector<Occluder> picked;
+    size_t triangles = 0;
+    for (const Candidate &candidate : candidates)
+    {
+        if (triangles + candidate.triangles > kMaxOccluderTriangles)
+            continue; // Smaller meshes further down may still fit
+        triangles += candidate.triangles;
+        if (candidate.occluder != kNewCandidate)
+        {
+            picked.push_back(std::move(occluders[candidate.occluder]));
+            continue;
+        }
+        Occluder occluder;
+        extract(meshes[candidate.mesh], candidate.mesh, occluder);
+        occluder.surfaceArea = candidate.surfaceArea;
+        picked.push_back(std::move(occluder));
+    }
+    occluders = std::move(picked);
+}
+
+// The stages every freshly packed model goes through, whichever importer packed it: optional vertex cache optimization,
+// splitting of triangle meshes too large for 16-bit indices into spatial chunks, detail levels, index narrowing and
+// bounding spheres. run() may be called batch by batch; take() then hands out the resulting meshes (all at once or batch
+// by batch) and finish() logs what was done.
+struct MeshPostProcessor
+{
+    MeshPostProcessor(const LoadSettings &settings, std::vector<bool> triangleMeshes)
+        : settings(settings), triangleMeshes(std::move(triangleMeshes)), meshStats(this->triangleMeshes.size()),
+          chunks(this->triangleMeshes.size())
+    {
+    }
+
+    // Processes meshes [first, last) of the model; returns false if the load was cancelled
+    bool run(ModelData &model, size_t first, size_t last, LoadCancelToken cancel)
+    {
+        WorkerPool &pool = GetWorkerPool();
+        if (settings.optimizeMeshes)
+        {
+            // Only pure triangle meshes are reordered; point and line meshes keep their primitive order
+            pool.parallelFor(last - first, [&](size_t k)
+                             {
+                const size_t i = first + k;
+                if (!cancel.cancelled() && model.meshes[i].instanceCount > 0 && triangleMeshes[i])
+                    meshStats[i] = optimizeMeshData(model.meshes[i], settings.optimizeOverdraw); });
+            if (cancel.cancelled())
+                return false;
+        }
+
+        // Split triangle meshes too large for 16-bit indices into spatial chunks, then narrow every index buffer that fits
+        pool.parallelFor(last - first, [&](size_t k)
+                         {
+            const size_t i = first + k;
+            if (cancel.cancelled())
+                return;
+            MeshData &meshData = model.meshes[i];
+            if (meshData.instanceCount == 0)
+                return; // Not referenced by any node
+            if (meshData.vertexCount > kMaxShortIndexVertices && triangleMeshes[i])
+                chunks[i] = splitMeshChunks(meshData);
+            else
+                chunks[i].push_back(std::move(meshData));
+            for (MeshData &chunk : chunks[i])
+            {
+                if (settings.generateLods && triangleMeshes[i])
+                    GenerateMeshLods(chunk, settings.optimizeMeshes);
+                narrowIndices(chunk);
+                FitBoundingSphere(chunk);
+            } });
+        return !cancel.cancelled();
+    }
+
+    // Moves the processed meshes of source meshes [first, last) out, in order; unreferenced meshes yield nothing
+    std::vector<MeshData> take(size_t first, size_t last)
+    {
+        std::vector<MeshData> meshes;
+        for (size_t i = first; i < last; ++i)
+        {
+            splitMeshes += chunks[i].size() > 1 ? 1 : 0;
+            for (MeshData &chunk : chunks[i])
+            {
+                for (size_t l = 0; l < kMaxMeshLods; ++l)
+                    levelTriangles[l] += (l < chunk.lods.size() ? chunk.lods[l].indexCount : (l == 0 ? chunk.indexCount : 0)) / 3;
+                meshes.push_back(std::move(chunk));
+            }
+            std::vector<MeshData>().swap(chunks[i]);
+        }
+        takenMeshes += meshes.size();
+        return meshes;
+    }
+
+    // Logs the statistics of everything taken
+    void finish()
+    {
+        if (settings.optimizeMeshes)
+        {
+            VertexCacheStats before, after;
+            for (const auto &stats : meshStats)
+            {
+                before += stats.first;
+                after += stats.second;
+            }
+            spdlog::info("Vertex cache ({} triangles): ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}",
+                         before.triangles, before.acmr(), after.acmr(), before.atvr(), after.atvr());
+        }
+        if (splitMeshes > 0)
+            spdlog::info("Split {} large meshes into 16-bit index chunks ({} meshes total)", splitMeshes, takenMeshes);
+        if (settings.generateLods)
+            spdlog::info("Detail levels: {} / {} / {} / {} triangles", levelTriangles[0], levelTriangles[1], levelTriangles[2], levelTriangles[3]);
+    }
+
+private:
+    const LoadSettings &settings;
+    std::vector<bool> triangleMeshes; // Per packed mesh; point and line meshes are never reordered, chunked or simplified
+    std::vector<std::pair<VertexCacheStats, VertexCacheStats>> meshStats;
+    std::vector<std::vector<MeshData>> chunks;
+    size_t splitMeshes = 0, takenMeshes = 0;
+    size_t levelTriangles[kMaxMeshLods] = {};
+};
+
+// --- Persistent mesh cache ---
+// One file per source model holding the final packed buffers, so repeat loads skip Assimp entirely.
+// Layout (offsets from the start of the file, everything 8-byte aligned so it can be used in place from a mapping):
+//   MeshCacheHeader | payload (vertices, indices, texture key strings, embedded image bytes)
+//   | MeshCacheMesh[meshCount] | MeshCacheMaterial[materialCount] | MeshCacheString[keyCount]
+//   | MeshCacheTexture[textureCount] | float[16][instanceCount] (column-major instance transforms)
+// The tables come last so meshes can be written while the model is still being packed (see MeshCacheWriter).
+constexpr char kMeshCacheMagic[8] = {'S', 'M', 'V', 'M', 'E', 'S', 'H', '\0'};
+constexpr uint32_t kMeshCacheVersion = 9; // Bump whenever the packed vertex/index format or this layout changes
+
+struct MeshCacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t meshCount;
+    uint64_t sourceSize;  // Source model file size in bytes
+    int64_t sourceMtime;  // Source model last write time (filesystem clock ticks)
+    uint64_t sourceHash;  // HashFileContents of the source model
+    uint32_t materialCount;
+    uint32_t keyCount;      // Texture keys referenced by the materials
+    uint32_t textureCount;  // Embedded textures stored in the cache
+    uint32_t vertexFormat;     // VertexFormat of every mesh
+    uint32_t packFlags;        // MeshCachePackFlags of the settings the meshes were packed with
+    uint32_t instanceCount;    // Instance transforms stored in the cache
+    uint32_t vertexAttributes; // VertexAttributeBits stored in every mesh's vertices
+    uint64_t tablesOffset;     // Where MeshCacheMesh[meshCount] and the other tables start
+};
+
+struct MeshCacheMesh
+{
+    uint64_t vertexOffset, vertexCount; // vertexCount vertices in the header's vertex format and attributes
+    uint64_t indexOffset, indexCount;
+    uint32_t materialIndex;
+    uint32_t indexSize; // 2 or 4 bytes
+    float boundsMin[3], boundsMax[3];
+    uint32_t firstInstance, instanceCount; // See MeshData
+    float sphere[4];                       // Bounding sphere center and radius
+    uint32_t lodCount;                     // Detail levels, stored back to back in the indices (0 = just one)
+    uint32_t lodIndexCounts[kMaxMeshLods];
+    float lodErrors[kMaxMeshLods];
+    uint32_t reserved;
+};
+
+struct MeshCacheMaterial
+{
+    uint32_t firstKey, keyCount; // Range in the MeshCacheString table
+};
+
+struct MeshCacheString
+{
+    uint64_t offset, length;
+};
+
+struct MeshCacheTexture
+{
+    uint32_t keyIndex;      // Texture key this payload belongs to
+    uint32_t width, height; // aiTexture convention: height 0 means 'width' bytes of compressed data
+    uint32_t reserved;
+    uint64_t dataOffset, dataSize;
+};
+
+// Identity of a source model file; the cache entry is valid only for the same size and mtime (or the same content)
+struct SourceFileStamp
+{
+    uint64_t size = 0;
+    int64_t mtime = 0;
+};
+
+bool GetSourceFileStamp(const std::string &path, SourceFileStamp &stamp)
+{
+    std::error_code ec;
+    stamp.size = std::filesystem::file_size(path, ec);
+    if (ec)
+        return false;
+    stamp.mtime = static_cast<int64_t>(std::filesystem::last_write_time(path, ec).time_since_epoch().count());
+    return !ec;
+}
+
+// Cache file for a model, named after a hash of its absolute path. Returns an empty path if no cache directory is available.
+std::filesystem::path MeshCachePath(const std::string &modelPath)
+{
+    std::filesystem::path dir;
+#ifdef _WIN32
+    if (const char *local = std::getenv("LOCALAPPDATA"))
+        dir = std::filesystem::path(local) / "simple_model_viewer" / "mesh_cache";
+#else
+    if (const char *xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg)
+        dir = std::filesystem::path(xdg) / "simple_model_viewer" / "mesh_cache";
+    else if (const char *home = std::getenv("HOME"))
+        dir = std::filesystem::path(home) / ".cache" / "simple_model_viewer" / "mesh_cache";
+#endif
+    if (dir.empty())
+        return {};
+
+    std::error_code ec;
+    std::string absolute = std::filesystem::absolute(modelPath, ec).lexically_normal().string();
+    uint64_t pathHash = HashBytes(reinterpret_cast<const unsigned char *>(absolute.data()), absolute.size());
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.meshcache", static_cast<unsigned long long>(pathHash));
+    return dir / name;
+}
+
+// Load settings that change the packed meshes, beyond the vertex format
+uint32_t MeshCachePackFlags(const LoadSettings &settings)
+{
+    uint32_t flags = 0;
+    if (settings.optimizeMeshes)
+        flags |= 1u << 0;
+    if (settings.optimizeMeshes && settings.optimizeOverdraw)
+        flags |= 1u << 1;
+    if (settings.generateLods)
+        flags |= 1u << 2;
+    return flags;
+}
+
+// Looks up an embedded image by the part of its texture key after the model path (e.g. "*0"); false if there is none
+using EmbeddedTextureLookup = std::function<bool(const std::string &name, EmbeddedTextureSource &source)>;
+
+// Writes a mesh cache entry. Meshes are added as they are packed, possibly batch by batch while the source meshes of
+// later batches do not exist yet, or reserved and then filled range by range by the packing threads; finish() appends
+// the tables once the model is complete. The file is written under a
+// temporary name and renamed into place, so concurrent loads never see a partial cache; an unfinished entry is removed.
+struct MeshCacheWriter
+{
+    MeshCacheWriter() = default;
+    MeshCacheWriter(const MeshCacheWriter &) = delete;
+    MeshCacheWriter &operator=(const MeshCacheWriter &) = delete;
+
+    ~MeshCacheWriter()
+    {
+        if (out.is_open())
+        {
+            out.close();
+            std::error_code ec;
+            std::filesystem::remove(tmpPath, ec);
+        }
+    }
+
+    bool open(const std::filesystem::path &path)
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(path.parent_path(), ec);
+        cachePath = path;
+        tmpPath = path;
+        tmpPath += ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+        out.open(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open())
+        {
+            spdlog::warn("Cannot write mesh cache: {}", tmpPath.string());
+            return false;
+        }
+        MeshCacheHeader placeholder{}; // Rewritten by finish()
+        write(&placeholder, sizeof(placeholder), 0);
+        return true;
+    }
+
+    bool isOpen() const { return out.is_open(); }
+
+    // Appends a packed mesh; 'vertices' and 'indices' hold its data in the layout and index size 'meshData' describes
+    void addMesh(const MeshData &meshData, const void *vertices, const void *indices)
+    {
+        const size_t mesh = reserveMesh(meshData);
+        writeAt(vertexOffset(mesh), vertices, meshData.vertexCount * meshData.layout.stride());
+        writeAt(indexOffset(mesh), indices, meshData.indexCount * meshData.indexSize);
+        describeMesh(mesh, meshData);
+    }
+
+    // Reserves room for a mesh with the counts, layout and index size of 'meshData' and returns its entry. Its data then
+    // goes in with writeAt, from any thread and in any order, and the rest of the entry with describeMesh once known.
+    size_t reserveMesh(const MeshData &meshData)
+    {
+        MeshCacheMesh entry{};
+        entry.vertexCount = meshData.vertexCount;
+        entry.indexCount = meshData.indexCount;
+        entry.indexSize = meshData.indexSize;
+        entry.vertexOffset = align8(written);
+        entry.indexOffset = align8(entry.vertexOffset + meshData.vertexCount * meshData.layout.stride());
+        written = entry.indexOffset + meshData.indexCount * meshData.indexSize;
+        meshes.push_back(entry);
+        vertexAttributes = meshData.layout.attributes; // Shared by all meshes of a model
+        return meshes.size() - 1;
+    }
+
+    void describeMesh(size_t mesh, const MeshData &meshData)
+    {
+        MeshCacheMesh &entry = meshes[mesh];
+        entry.materialIndex = meshData.materialIndex;
+        entry.firstInstance = meshData.firstInstance;
+        entry.instanceCount = meshData.instanceCount;
+        std::memcpy(entry.boundsMin, glm::value_ptr(meshData.boundsMin), sizeof(entry.boundsMin));
+        std::memcpy(entry.boundsMax, glm::value_ptr(meshData.boundsMax), sizeof(entry.boundsMax));
+        std::memcpy(entry.sphere, glm::value_ptr(meshData.sphereCenter), sizeof(float) * 3);
+        entry.sphere[3] = meshData.sphereRadius;
+        entry.lodCount = static_cast<uint32_t>(meshData.lods.size());
+        for (size_t l = 0; l < meshData.lods.size(); ++l)
+        {
+            entry.lodIndexCounts[l] = static_cast<uint32_t>(meshData.lods[l].indexCount);
+            entry.lodErrors[l] = meshData.lods[l].error;
+        }
+    }
+
+    uint64_t vertexOffset(size_t mesh) const { return meshes[mesh].vertexOffset; }
+    uint64_t indexOffset(size_t mesh) const { return meshes[mesh].indexOffset; }
+
+    // Writes 'size' bytes at 'at', inside the room of a reserved mesh; safe to call from several threads at once
+    void writeAt(uint64_t at, const void *data, uint64_t size)
+    {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        out.seekp(static_cast<std::streamoff>(at));
+        out.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+    }
+
+    // Appends the texture keys, embedded images and tables of 'model', whose meshes must have been added in order
+    bool finish(const SourceFileStamp &stamp, uint64_t sourceHash, const LoadSettings &settings, const ModelData &model,
+                const EmbeddedTextureLookup &findEmbedded)
+    {
+        // Flatten the texture keys and pick out the embedded textures they reference
+        std::vector<MeshCacheMaterial> materials;
+        std::vector<const std::string *> keys;
+        for (const auto &materialKeys : model.materialTextureKeys)
+        {
+            materials.push_back({static_cast<uint32_t>(keys.size()), static_cast<uint32_t>(materialKeys.size())});
+            for (const auto &key : materialKeys)
+                keys.push_back(&key);
+        }
+        std::vector<MeshCacheTexture> textures;
+        std::unordered_map<std::string, bool> storedKeys;
+        std::vector<MeshCacheString> strings(keys.size());
+        for (size_t k = 0; k < keys.size(); ++k)
+        {
+            strings[k].offset = align8(written);
+            strings[k].length = keys[k]->size();
+            write(keys[k]->data(), strings[k].length, strings[k].offset);
+        }
+        for (size_t k = 0; k < keys.size(); ++k)
+        {
+            const std::string &key = *keys[k];
+            if (key.size() <= model.path.size() || key.compare(0, model.path.size(), model.path) != 0 || key[model.path.size()] != '*')
+                continue; // External file, decoded from disk on load
+            if (!storedKeys.emplace(key, true).second)
+                continue;
+            EmbeddedTextureSource source;
+            if (!findEmbedded(key.substr(model.path.size()), source))
+                continue;
+            MeshCacheTexture entry{};
+            entry.keyIndex = static_cast<uint32_t>(k);
+            entry.width = source.width;
+            entry.height = source.height;
+            entry.dataSize = source.height == 0 ? source.width : static_cast<uint64_t>(source.width) * source.height * 4;
+            entry.dataOffset = align8(written);
+            write(source.data, entry.dataSize, entry.dataOffset);
+            textures.push_back(entry);
+        }
+
+        MeshCacheHeader header{};
+        std::memcpy(header.magic, kMeshCacheMagic, sizeof(kMeshCacheMagic));
+        header.version = kMeshCacheVersion;
+        header.meshCount = static_cast<uint32_t>(meshes.size());
+        header.sourceSize = stamp.size;
+        header.sourceMtime = stamp.mtime;
+        header.sourceHash = sourceHash;
+        header.materialCount = static_cast<uint32_t>(materials.size());
+        header.keyCount = static_cast<uint32_t>(keys.size());
+        header.textureCount = static_cast<uint32_t>(textures.size());
+        header.vertexFormat = static_cast<uint32_t>(settings.vertexFormat);
+        header.packFlags = MeshCachePackFlags(settings);
+        header.instanceCount = static_cast<uint32_t>(model.instanceTransforms.size());
+        header.vertexAttributes = vertexAttributes;
+        header.tablesOffset = align8(written);
+        write(meshes.data(), meshes.size() * sizeof(MeshCacheMesh), header.tablesOffset);
+        write(materials.data(), materials.size() * sizeof(MeshCacheMaterial), written);
+        write(strings.data(), strings.size() * sizeof(MeshCacheString), written);
+        write(textures.data(), textures.size() * sizeof(MeshCacheTexture), written);
+        write(model.instanceTransforms.data(), model.instanceTransforms.size() * sizeof(glm::mat4), written);
+        out.seekp(0);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.close();
+
+        std::error_code ec;
+        if (!out)
+        {
+            std::filesystem::remove(tmpPath, ec);
+            spdlog::warn("Failed to write mesh cache: {}", tmpPath.string());
+            return false;
+        }
+        std::filesystem::rename(tmpPath, cachePath, ec);
+        if (ec)
+        {
+            std::filesystem::remove(tmpPath, ec);
+            return false;
+        }
+        spdlog::info("Wrote mesh cache: {} ({} MB)", cachePath.string(), written >> 20);
+        return true;
+    }
+
+private:
+    static uint64_t align8(uint64_t offset) { return (offset + 7) & ~uint64_t(7); }
+
+    // Writes 'size' bytes at 'at' (>= written), zero-padding the gap
+    void write(const void *data, uint64_t size, uint64_t at)
+    {
+        static const char zeros[8] = {};
+        out.seekp(static_cast<std::streamoff>(written)); // writeAt may have left the position inside a mesh
+        out.write(zeros, static_cast<std::streamsize>(at - written)); // Alignment padding
+        out.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+        written = at + size;
+    }
+
+    std::filesystem::path cachePath, tmpPath;
+    std::ofstream out;
+    uint64_t written = 0;
+    std::vector<MeshCacheMesh> meshes;
+    uint32_t vertexAttributes = 0;
+    std::mutex writeMutex;
+};
+
+// Writes a packed model to the mesh cache in one go. Called while the imported file is still alive so embedded images can be stored too.
+bool writeMeshCache(const std::filesystem::path &cachePath, const SourceFileStamp &stamp, uint64_t sourceHash,
+                    const LoadSettings &settings, const ModelData &model, const EmbeddedTextureLookup &findEmbedded)
+{
+    MeshCacheWriter writer;
+    if (!writer.open(cachePath))
+        return false;
+    for (const MeshData &meshData : model.meshes)
+        writer.addMesh(meshData, meshData.vertices, meshData.indices);
+    return writer.finish(stamp, sourceHash, settings, model, findEmbedded);
+}
+
+// True if all 'count' indices are below 'vertexCount'
+template <typename Index>
+bool IndicesBelow(const Index *indices, size_t count, size_t vertexCount)
+{
+    Index largest = 0;
+    for (size_t k = 0; k < count; ++k)
+        largest = std::max(largest, indices[k]);
+    return count == 0 || largest < vertexCount;
+}
+
+// Opens the mesh cache of a model. On a hit the returned meshes point straight into the mapped file (no Assimp, no copies);
+// only the textures are decoded. Returns nullptr on a miss, a stale or corrupt cache file, or cancellation.
+std::unique_ptr<ModelData> readMeshCache(const std::filesystem::path &cachePath, const std::string &modelPath,
+                                         const SourceFileStamp &stamp, const LoadSettings &settings, LoadCancelToken cancel)
+{
+    std::unique_ptr<MappedFile> mapping = MappedFile::open(cachePath.string());
+    if (!mapping || mapping->size() < sizeof(MeshCacheHeader))
+        return nullptr;
+
+    const unsigned char *base = mapping->data();
+    const size_t fileSize = mapping->size();
+    MeshCacheHeader header;
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.magic, kMeshCacheMagic, sizeof(kMeshCacheMagic)) != 0 || header.version != kMeshCacheVersion ||
+        header.sourceSize != stamp.size || header.vertexFormat != static_cast<uint32_t>(settings.vertexFormat) ||
+        header.packFlags != MeshCachePackFlags(settings) || (header.vertexAttributes & ~kAllVertexAttributes) != 0)
+        return nullptr; // A cache packed with other settings is rebuilt rather than converted
+    if (header.sourceMtime != stamp.mtime)
+    {
+        // Touched but possibly unchanged (e.g. copied or checked out again): fall back to comparing the content hash
+        std::unique_ptr<MappedFile> source = MappedFile::open(modelPath);
+        if (!source || HashFileContents(*source) != header.sourceHash)
+            return nullptr;
+    }
+
+    // Validate the tables before trusting any offset in them
+    auto inBounds = [&](uint64_t offset, uint64_t size)
+    { return offset <= fileSize && size <= fileSize - offset && offset % 4 == 0; };
+    // Counts are checked by dividing, so a huge count from a damaged file cannot wrap the byte size around
+    auto arrayInBounds = [&](uint64_t offset, uint64_t count, uint64_t elementSize)
+    { return inBounds(offset, 0) && count <= (fileSize - offset) / elementSize; };
+    uint64_t tablesSize = uint64_t(header.meshCount) * sizeof(MeshCacheMesh) + uint64_t(header.materialCount) * sizeof(MeshCacheMaterial) +
+                          uint64_t(header.keyCount) * sizeof(MeshCacheString) + uint64_t(header.textureCount) * sizeof(MeshCacheTexture) +
+                          uint64_t(header.instanceCount) * sizeof(glm::mat4);
+    if (header.tablesOffset % 8 != 0 || !inBounds(header.tablesOffset, tablesSize))
+        return nullptr;
+    const auto *meshes = reinterpret_cast<const MeshCacheMesh *>(base + header.tablesOffset);
+    const auto *materials = reinterpret_cast<const MeshCacheMaterial *>(meshes + header.meshCount);
+    const auto *strings = reinterpret_cast<const MeshCacheString *>(materials + header.materialCount);
+    const auto *textures = reinterpret_cast<const MeshCacheTexture *>(strings + header.keyCount);
+    const auto *instances = reinterpret_cast<const unsigned char *>(textures + header.textureCount);
+
+    auto model = std::make_unique<ModelData>();
+    model->path = modelPath;
+    model->constantColor = settings.defaultColor;
+    const VertexLayout layout{settings.vertexFormat, header.vertexAttributes};
+    model->instanceTransforms.resize(header.instanceCount);
+    std::memcpy(model->instanceTransforms.data(), instances, header.instanceCount * sizeof(glm::mat4));
+    model->meshes.resize(header.meshCount);
+    for (uint32_t i = 0; i < header.meshCount; ++i)
+    {
+        const MeshCacheMesh &entry = meshes[i];
+        if (!arrayInBounds(entry.vertexOffset, entry.vertexCount, layout.stride()) ||
+            !(entry.indexSize == sizeof(uint32_t) || (entry.indexSize == sizeof(uint16_t) && entry.vertexCount <= kMaxShortIndexVertices)) ||
+            !arrayInBounds(entry.indexOffset, entry.indexCount, entry.indexSize) ||
+            (entry.instanceCount > 1 && uint64_t(entry.firstInstance) + entry.instanceCount > header.instanceCount) ||
+            entry.lodCount > kMaxMeshLods)
+            return nullptr;
+        MeshData &meshData = model->meshes[i];
+        meshData.vertices = base + entry.vertexOffset;
+        meshData.vertexCount = entry.vertexCount;
+        meshData.layout = layout;
+        meshData.indices = base + entry.indexOffset;
+        meshData.indexCount = entry.indexCount;
+        meshData.indexSize = entry.indexSize;
+        meshData.materialIndex = entry.materialIndex;
+        meshData.firstInstance = entry.firstInstance;
+        meshData.instanceCount = entry.instanceCount;
+        meshData.boundsMin = glm::vec3(entry.boundsMin[0], entry.boundsMin[1], entry.boundsMin[2]);
+        meshData.boundsMax = glm::vec3(entry.boundsMax[0], entry.boundsMax[1], entry.boundsMax[2]);
+        meshData.sphereCenter = glm::vec3(entry.sphere[0], entry.sphere[1], entry.sphere[2]);
+        meshData.sphereRadius = entry.sphere[3];
+        size_t firstIndex = 0;
+        for (uint32_t l = 0; l < entry.lodCount; ++l)
+        {
+            meshData.lods.push_back({firstIndex, entry.lodIndexCounts[l], entry.lodErrors[l]});
+            firstIndex += entry.lodIndexCounts[l];
+        }
+        if (firstIndex > entry.indexCount)
+            return nullptr;
+    }
+    // The GPU and the software occlusion rasterizer use the indices unchecked, so each one is checked once against its mesh
+    std::vector<char> indicesValid(model->meshes.size(), 0); // char rather than bool so workers can write concurrently
+    GetWorkerPool().parallelFor(model->meshes.size(), [&](size_t i)
+                                {
+        const MeshData &meshData = model->meshes[i];
+        indicesValid[i] = meshData.indexSize == sizeof(uint16_t)
+                              ? IndicesBelow(static_cast<const uint16_t *>(meshData.indices), meshData.indexCount, meshData.vertexCount)
+                              : IndicesBelow(static_cast<const uint32_t *>(meshData.indices), meshData.indexCount, meshData.vertexCount); });
+    if (std::find(indicesValid.begin(), indicesValid.end(), 0) != indicesValid.end())
+    {
+        spdlog::warn("Mesh cache has indices out of range, rebuilding it: {}", cachePath.string());
+        return nullptr;
+    }
+
+    std::vector<std::string> keys(header.keyCount);
+    for (uint32_t k = 0; k < header.keyCount; ++k)
+    {
+        if (!inBounds(strings[k].offset, strings[k].length))
+            return nullptr;
+        keys[k].assign(reinterpret_cast<const char *>(base + strings[k].offset), strings[k].length);
+    }
+    std::unordered_map<std::string, EmbeddedTextureSource> embedded;
+    for (uint32_t t = 0; t < header.textureCount; ++t)
+    {
+        const MeshCacheTexture &entry = textures[t];
+        if (entry.keyIndex >= header.keyCount || !inBounds(entry.dataOffset, entry.dataSize))
+            return nullptr;
+        EmbeddedTextureSource source;
+        source.data = base + entry.dataOffset;
+        source.width = entry.width;
+        source.height = entry.height;
+        embedded[keys[entry.keyIndex]] = source;
+    }
+
+    // Decode the referenced textures in parallel; keys that no longer decode are dropped like on a fresh import
+    TextureRequestSet requestSet;
+    std::vector<size_t> requestIndex(header.keyCount);
+    for (uint32_t k = 0; k < header.keyCount; ++k)
+    {
+        TextureDecodeRequest request;
+        request.key = keys[k];
+        auto source = embedded.find(keys[k]);
+        if (source != embedded.end())
+        {
+            request.embedded = true;
+            request.source = source->second;
+        }
+        requestIndex[k] = requestSet.add(std::move(request));
+    }
+    requestSet.decodePending(model->textures, cancel);
+    if (cancel.cancelled())
+        return nullptr;
+
+    model->materialTextureKeys.resize(header.materialCount);
+    for (uint32_t m = 0; m < header.materialCount; ++m)
+    {
+        if (uint64_t(materials[m].firstKey) + materials[m].keyCount > header.keyCount)
+            return nullptr;
+        for (uint32_t k = materials[m].firstKey; k < materials[m].firstKey + materials[m].keyCount; ++k)
+        {
+            if (requestSet.isUsable(requestIndex[k]))
+                model->materialTextureKeys[m].push_back(keys[k]);
+        }
+    }
+
+    model->mappings.push_back(std::move(mapping));
+    return model;
+}
+
+// --- Native glTF 2.0 loader ---
+// glTF files (.glb, or .gltf with external .bin buffers) are read straight from memory mappings, without Assimp: no
+// imported scene, no intermediate copies. Accessors are packed into the vertex layout like Assimp meshes, except where
+// the file already holds the final data: a primitive whose buffer view is exactly the layout (float positions, normals,
+// colors and UVs interleaved at the layout's offsets) or whose indices are tightly packed 16-bit ones points into the
+// mapping, which the model keeps alive, so the upload copies it to the GPU directly. Embedded images are decoded from
+// the binary chunk in place. Anything this loader leaves to Assimp (required extensions such as Draco or meshopt
+// compression, sparse accessors, data URIs, non-triangle primitives) makes the model go through Assimp instead.
+
+// Minimal JSON document tree, enough for glTF's JSON chunk
+struct JsonValue
+{
+    enum class Type
+    {
+        Null,
+        Bool,
+        Number,
+        String,
+        Array,
+        Object
+    };
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> elements; // Array elements, or object member values
+    std::vector<std::string> keys;   // Object member names, parallel to 'elements'
+
+    // Object member; a null value if there is none
+    const JsonValue &operator[](const char *key) const
+    {
+        if (type == Type::Object)
+        {
+            for (size_t i = 0; i < keys.size(); ++i)
+                if (keys[i] == key)
+                    return elements[i];
+        }
+        return null();
+    }
+
+    // Array element; a null value if out of range
+    const JsonValue &at(size_t index) const
+    {
+        return type == Type::Array && index < elements.size() ? elements[index] : null();
+    }
+
+    size_t size() const { return type == Type::Array ? elements.size() : 0; }
+    double asNumber(double fallback) const { return type == Type::Number ? number : fallback; }
+
+    // A glTF index, count or offset; 'fallback' if absent or not a non-negative integer
+    int64_t asIndex(int64_t fallback = -1) const
+    {
+        if (type != Type::Number || number < 0.0 || number > 9007199254740992.0 || number != std::floor(number))
+            return fallback;
+        return static_cast<int64_t>(number);
+    }
+
+private:
+    static const JsonValue &null()
+    {
+        static const JsonValue value;
+        return value;
+    }
+};
+
+// Recursive-descent JSON parser over [at, end)
+struct JsonParser
+{
+    const char *at;
+    const char *end;
+
+    // Parses one value covering the whole input; false on malformed input
+    bool parse(JsonValue &out)
+    {
+        if (end - at >= 3 && std::memcmp(at, "\xEF\xBB\xBF", 3) == 0)
+            at += 3; // UTF-8 byte order mark
+        if (!parseValue(out, 0))
+            return false;
+        skipSpace();
+        return at == end;
+    }
+
+private:
+    static constexpr int kMaxDepth = 64; // Far more than glTF needs; bounds the recursion on hostile input
+
+    void skipSpace()
+    {
+        while (at < end && (*at == ' ' || *at == '\t' || *at == '\n' || *at == '\r'))
+            ++at;
+    }
+
+    bool consume(char c)
+    {
+        skipSpace();
+        if (at == end || *at != c)
+            return false;
+        ++at;
+        return true;
+    }
+
+    bool literal(const char *word)
+    {
+        size_t length = std::strlen(word);
+        if (size_t(end - at) < length || std::memcmp(at, word, length) != 0)
+            return false;
+        at += length;
+        return true;
+    }
+
+    bool parseValue(JsonValue &out, int depth)
+    {
+        skipSpace();
+        if (at == end || depth > kMaxDepth)
+            return false;
+        switch (*at)
+        {
+        case '{':
+            ++at;
+            out.type = JsonValue::Type::Object;
+            if (consume('}'))
+                return true;
+            do
+            {
+                out.keys.emplace_back();
+                out.elements.emplace_back();
+                skipSpace();
+                if (!parseString(out.keys.back()) || !consume(':') || !parseValue(out.elements.back(), depth + 1))
+                    return false;
+            } while (consume(','));
+            return consume('}');
+        case '[':
+            ++at;
+            out.type = JsonValue::Type::Array;
+            if (consume(']'))
+                return true;
+            do
+            {
+                out.elements.emplace_back();
+                if (!parseValue(out.elements.back(), depth + 1))
+                    return false;
+            } while (consume(','));
+            return consume(']');
+        case '"':
+            out.type = JsonValue::Type::String;
+            return parseString(out.string);
+        case 't':
+            out.type = JsonValue::Type::Bool;
+            out.boolean = true;
+            return literal("true");
+        case 'f':
+            out.type = JsonValue::Type::Bool;
+            return literal("false");
+        case 'n':
+            return literal("null");
+        default:
+        {
+            // strtod wants a terminated string, and numbers are short
+            char buffer[64];
+            size_t length = 0;
+            while (at + length < end && length + 1 < sizeof(buffer) && at[length] != '\0' && std::strchr("+-.0123456789eE", at[length]))
+            {
+                buffer[length] = at[length];
+                ++length;
+            }
+            buffer[length] = '\0';
+            char *stop = buffer;
+            out.number = std::strtod(buffer, &stop);
+            if (stop == buffer)
+                return false;
+            out.type = JsonValue::Type::Number;
+            at += stop - buffer;
+            return true;
+        }
+        }
+    }
+
+    bool parseHex4(uint32_t &code)
+    {
+        if (end - at < 4)
+            return false;
+        code = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            char c = *at++;
+            uint32_t digit = c >= '0' && c <= '9' ? c - '0' : (c >= 'a' && c <= 'f' ? c - 'a' + 10 : (c >= 'A' && c <= 'F' ? c - 'A' + 10 : 16));
+            if (digit > 15)
+                return false;
+            code = code * 16 + digit;
+        }
+        return true;
+    }
+
+    bool parseString(std::string &out)
+    {
+        if (at == end || *at != '"')
+            return false;
+        ++at;
+        while (at < end && *at != '"')
+        {
+            if (*at != '\\')
+            {
+                out.push_back(*at++);
+                continue;
+            }
+            if (++at == end)
+                return false;
+            char escape = *at++;
+            uint32_t code = 0;
+            switch (escape)
+            {
+            case 'b':
+                out.push_back('\b');
+                break;
+            case 'f':
+                out.push_back('\f');
+                break;
+            case 'n':
+                out.push_back('\n');
+                break;
+            case 'r':
+                out.push_back('\r');
+                break;
+            case 't':
+                out.push_back('\t');
+                break;
+            case 'u':
+                if (!parseHex4(code))
+                    return false;
+                if (code >= 0xD800 && code < 0xDC00 && end - at >= 6 && at[0] == '\\' && at[1] == 'u')
+                {
+                    // Surrogate pair
+                    at += 2;
+                    uint32_t low = 0;
+                    if (!parseHex4(low) || low < 0xDC00 || low >= 0xE000)
+                        return false;
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                }
+                if (code < 0x80)
+                    out.push_back(static_cast<char>(code));
+                else if (code < 0x800)
+                {
+                    out.push_back(static_cast<char>(0xC0 | (code >> 6)));
+                    out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+                }
+                else if (code < 0x10000)
+                {
+                    out.push_back(static_cast<char>(0xE0 | (code >> 12)));
+                    out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+                    out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+                }
+                else
+                {
+                    out.push_back(static_cast<char>(0xF0 | (code >> 18)));
+                    out.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+                    out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+                    out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+                }
+                break;
+            default: // '"', '\\' and '/' stand for themselves
+                out.push_back(escape);
+                break;
+            }
+        }
+        if (at == end)
+            return false;
+        ++at;
+        return true;
+    }
+};
+
+bool IsGltfPath(const std::string &path)
+{
+    std::string extension = std::filesystem::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c)
+                   { return static_cast<char>(std::tolower(c)); });
+    return extension == ".gltf" || extension == ".glb";
+}
+
+// Decodes the %XX escapes of a relative URI into a file path
+std::string DecodeUri(const std::string &uri)
+{
+    std::string decoded;
+    for (size_t i = 0; i < uri.size(); ++i)
+    {
+        if (uri[i] == '%' && i + 2 < uri.size() && std::isxdigit(static_cast<unsigned char>(uri[i + 1])) &&
+            std::isxdigit(static_cast<unsigned char>(uri[i + 2])))
+        {
+            decoded.push_back(static_cast<char>(std::stoi(uri.substr(i + 1, 2), nullptr, 16)));
+            i += 2;
+        }
+        else
+            decoded.push_back(uri[i]);
+    }
+    return decoded;
+}
+
+struct GltfBuffer
+{
+    const unsigned char *data = nullptr;
+    size_t size = 0;
+};
+
+// A glTF asset opened from memory mappings: the parsed JSON and the bytes of every buffer
+struct GltfAsset
+{
+    JsonValue json;
+    std::vector<GltfBuffer> buffers;
+    std::vector<std::unique_ptr<MappedFile>> files; // The model file and its external buffers, handed over to the model
+};
+
+constexpr uint32_t kGlbJsonChunk = 0x4E4F534A; // "JSON"
+constexpr uint32_t kGlbBinChunk = 0x004E4942;  // "BIN\0"
+
+// Maps a .glb or .gltf file and its external buffers and parses the JSON. Returns false with the reason in 'unsupported'
+// if the file is malformed or needs something this loader leaves to Assimp.
+bool OpenGltfAsset(const std::string &path, const std::string &directory, GltfAsset &asset, std::string &unsupported)
+{
+    std::unique_ptr<MappedFile> file = MappedFile::open(path);
+    if (!file)
+    {
+        unsupported = "cannot map the file";
+        return false;
+    }
+    file->adviseSequential();
+    const unsigned char *base = file->data();
+    auto read32 = [&](size_t offset)
+    {
+        uint32_t value;
+        std::memcpy(&value, base + offset, sizeof(value));
+        return value;
+    };
+
+    // A .glb is a 12-byte header followed by chunks (length, type, data): JSON first, then optionally the binary buffer
+    const unsigned char *json = base;
+    size_t jsonSize = file->size();
+    GltfBuffer binChunk;
+    if (file->size() >= 12 && std::memcmp(base, "glTF", 4) == 0)
+    {
+        const size_t length = std::min<size_t>(read32(8), file->size());
+        if (read32(4) != 2 || length < 20 || read32(16) != kGlbJsonChunk || read32(12) > length - 20)
+        {
+            unsupported = "not a glTF 2.0 binary file";
+            return false;
+        }
+        json = base + 20;
+        jsonSize = read32(12);
+        const size_t binHeader = 20 + ((jsonSize + 3) & ~size_t(3)); // Chunks start 4-byte aligned
+        if (binHeader + 8 <= length && read32(binHeader + 4) == kGlbBinChunk && read32(binHeader) <= length - binHeader - 8)
+            binChunk = {base + binHeader + 8, read32(binHeader)};
+    }
+    JsonParser parser{reinterpret_cast<const char *>(json), reinterpret_cast<const char *>(json) + jsonSize};
+    if (!parser.parse(asset.json) || asset.json.type != JsonValue::Type::Object)
+    {
+        unsupported = "malformed JSON";
+        return false;
+    }
+    if (asset.json["asset"]["version"].string.rfind("2.", 0) != 0)
+    {
+        unsupported = "not glTF 2.0";
+        return false;
+    }
+    const JsonValue &required = asset.json["extensionsRequired"];
+    if (required.size() > 0)
+    {
+        unsupported = "requires extension " + required.at(0).string;
+        return false;
+    }
+
+    const JsonValue &buffers = asset.json["buffers"];
+    MappedIOSystem resolver(directory); // Finds buffer files like Assimp imports do
+    for (size_t b = 0; b < buffers.size(); ++b)
+    {
+        const JsonValue &buffer = buffers.at(b);
+        const std::string &uri = buffer["uri"].string;
+        GltfBuffer data;
+        if (uri.empty() && b == 0)
+            data = binChunk;
+        else if (uri.rfind("data:", 0) == 0)
+        {
+            unsupported = "data URI buffer";
+            return false;
+        }
+        else if (!uri.empty())
+        {
+            std::filesystem::path resolved = resolver.resolve(DecodeUri(uri).c_str());
+            std::unique_ptr<MappedFile> mapped = resolved.empty() ? nullptr : MappedFile::open(resolved.string());
+            if (mapped)
+            {
+                mapped->adviseSequential();
+                data = {mapped->data(), mapped->size()};
+                asset.files.push_back(std::move(mapped));
+            }
+        }
+        const int64_t byteLength = buffer["byteLength"].asIndex();
+        if (!data.data || byteLength < 0 || size_t(byteLength) > data.size)
+        {
+            unsupported = "missing or truncated buffer " + std::to_string(b);
+            return false;
+        }
+        data.size = size_t(byteLength);
+        asset.buffers.push_back(data);
+    }
+    asset.files.insert(asset.files.begin(), std::move(file));
+    return true;
+}
+
+// An accessor resolved against its buffer view: element i starts at data + i * stride
+struct GltfAccessor
+{
+    const unsigned char *data = nullptr; // Null if the primitive has no such accessor
+    size_t count = 0;
+    size_t stride = 0;
+    size_t available = 0;     // Bytes from 'data' to the end of the buffer view
+    GLenum componentType = 0; // GL_FLOAT, GL_UNSIGNED_SHORT, ...
+    int components = 0;       // 1 (SCALAR) to 4 (VEC4)
+    bool normalized = false;
+};
+
+size_t GltfComponentSize(GLenum componentType)
+{
+    switch (componentType)
+    {
+    case GL_BYTE:
+    case GL_UNSIGNED_BYTE:
+        return 1;
+    case GL_SHORT:
+    case GL_UNSIGNED_SHORT:
+        return 2;
+    case GL_UNSIGNED_INT:
+    case GL_FLOAT:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+// Resolves an accessor and checks every element lies within its buffer view. False for invalid accessors and for what
+// this loader leaves to Assimp: sparse storage, matrix types and accessors without a buffer view.
+bool ResolveGltfAccessor(const GltfAsset &asset, int64_t index, GltfAccessor &out)
+{
+    const JsonValue &accessor = asset.json["accessors"].at(size_t(index));
+    if (accessor.type != JsonValue::Type::Object || accessor["sparse"].type != JsonValue::Type::Null)
+        return false;
+    static const char *const kTypes[] = {"SCALAR", "VEC2", "VEC3", "VEC4"};
+    out.components = 0;
+    for (int t = 0; t < 4; ++t)
+        if (accessor["type"].string == kTypes[t])
+            out.components = t + 1;
+    out.componentType = static_cast<GLenum>(accessor["componentType"].asIndex(0));
+    const size_t elementSize = GltfComponentSize(out.componentType) * out.components;
+    const int64_t count = accessor["count"].asIndex();
+    const JsonValue &view = asset.json["bufferViews"].at(size_t(accessor["bufferView"].asIndex()));
+    const int64_t buffer = view["buffer"].asIndex();
+    if (elementSize == 0 || count < 0 || count > std::numeric_limits<unsigned int>::max() || buffer < 0 ||
+        size_t(buffer) >= asset.buffers.size())
+        return false;
+
+    const GltfBuffer &bytes = asset.buffers[size_t(buffer)];
+    const size_t viewOffset = size_t(view["byteOffset"].asIndex(0));
+    const size_t viewLength = size_t(view["byteLength"].asIndex(0));
+    const size_t offset = size_t(accessor["byteOffset"].asIndex(0));
+    out.stride = size_t(view["byteStride"].asIndex(0));
+    if (out.stride == 0)
+        out.stride = elementSize;
+    if (viewOffset > bytes.size || viewLength > bytes.size - viewOffset || offset > viewLength || out.stride < elementSize ||
+        (count > 0 && (viewLength - offset < elementSize || size_t(count - 1) > (viewLength - offset - elementSize) / out.stride)))
+        return false;
+    out.data = bytes.data + viewOffset + offset;
+    out.count = size_t(count);
+    out.available = viewLength - offset;
+    out.normalized = accessor["normalized"].boolean;
+    return true;
+}
+
+// Component c of element i as a float; normalized integers map to [0, 1] (unsigned) or [-1, 1] (signed)
+float ReadGltfComponent(const GltfAccessor &accessor, size_t i, int c)
+{
+    const unsigned char *p = accessor.data + i * accessor.stride + c * GltfComponentSize(accessor.componentType);
+    switch (accessor.componentType)
+    {
+    case GL_FLOAT:
+    {
+        float value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+    case GL_UNSIGNED_BYTE:
+        return accessor.normalized ? *p / 255.0f : *p;
+    case GL_BYTE:
+    {
+        int8_t value = static_cast<int8_t>(*p);
+        return accessor.normalized ? std::max(value / 127.0f, -1.0f) : value;
+    }
+    case GL_UNSIGNED_SHORT:
+    {
+        uint16_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return accessor.normalized ? value / 65535.0f : value;
+    }
+    case GL_SHORT:
+    {
+        int16_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return accessor.normalized ? std::max(value / 32767.0f, -1.0f) : value;
+    }
+    default:
+    {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return static_cast<float>(value);
+    }
+    }
+}
+
+uint32_t ReadGltfIndex(const GltfAccessor &accessor, size_t i)
+{
+    const unsigned char *p = accessor.data + i * accessor.stride;
+    if (accessor.componentType == GL_UNSIGNED_BYTE)
+        return *p;
+    if (accessor.componentType == GL_UNSIGNED_SHORT)
+    {
+        uint16_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// One mesh primitive, resolved to its accessors
+struct GltfPrimitive
+{
+    size_t mesh = 0; // glTF mesh it belongs to
+    int64_t material = -1;
+    GltfAccessor positions, normals, colors, texCoords, indices; // Only 'positions' is always present
+    std::vector<float> convertedColors, convertedTexCoords;      // Float copies of integer colors and UVs
+    std::vector<float> generatedNormals;                         // For primitives without normals
+};
+
+// Resolves a primitive's accessors; false with the reason in 'unsupported' if Assimp has to import it
+bool ResolveGltfPrimitive(const GltfAsset &asset, const JsonValue &source, GltfPrimitive &out, std::string &unsupported)
+{
+    if (source["mode"].asIndex(4) != 4)
+    {
+        unsupported = "point, line or strip primitives";
+        return false;
+    }
+    const JsonValue &attributes = source["attributes"];
+    auto resolve = [&](const char *name, GltfAccessor &accessor, std::initializer_list<int> components, bool integers)
+    {
+        const JsonValue &index = attributes[name];
+        if (index.type == JsonValue::Type::Null)
+            return true;
+        if (!ResolveGltfAccessor(asset, index.asIndex(), accessor) ||
+            std::find(components.begin(), components.end(), accessor.components) == components.end() ||
+            !(accessor.componentType == GL_FLOAT || (integers && accessor.normalized &&
+                                                     (accessor.componentType == GL_UNSIGNED_BYTE || accessor.componentType == GL_UNSIGNED_SHORT))))
+        {
+            unsupported = std::string("unsupported ") + name + " accessor";
+            return false;
+        }
+        return true;
+    };
+    if (!resolve("POSITION", out.positions, {3}, false) || !resolve("NORMAL", out.normals, {3}, false) ||
+        !resolve("COLOR_0", out.colors, {3, 4}, true) || !resolve("TEXCOORD_0", out.texCoords, {2}, true))
+        return false;
+    if (!out.positions.data)
+    {
+        unsupported = "primitive without positions";
+        return false;
+    }
+    for (const GltfAccessor *attribute : {&out.normals, &out.colors, &out.texCoords})
+    {
+        if (attribute->data && attribute->count != out.positions.count)
+        {
+            unsupported = "attribute counts differ";
+            return false;
+        }
+    }
+
+    if (source["indices"].type != JsonValue::Type::Null)
+    {
+        if (!ResolveGltfAccessor(asset, source["indices"].asIndex(), out.indices) || out.indices.components != 1 ||
+            !(out.indices.componentType == GL_UNSIGNED_BYTE || out.indices.componentType == GL_UNSIGNED_SHORT ||
+              out.indices.componentType == GL_UNSIGNED_INT))
+        {
+            unsupported = "unsupported index accessor";
+            return false;
+        }
+    }
+    if ((out.indices.data ? out.indices.count : out.positions.count) % 3 != 0)
+    {
+        unsupported = "incomplete triangles";
+        return false;
+    }
+    out.material = source["material"].asIndex();
+    return true;
+}
+
+// Float streams of a primitive. Integer colors and UVs are converted to float copies first.
+VertexStreams GltfVertexStreams(GltfPrimitive &primitive)
+{
+    VertexStreams streams;
+    streams.vertexCount = static_cast<unsigned int>(primitive.positions.count);
+    streams.positions = primitive.positions.data;
+    streams.positionStep = primitive.positions.stride;
+    if (primitive.normals.data)
+    {
+        streams.normals = primitive.normals.data;
+        streams.normalStep = primitive.normals.stride;
+    }
+    else if (!primitive.generatedNormals.empty())
+    {
+        streams.normals = reinterpret_cast<const unsigned char *>(primitive.generatedNormals.data());
+        streams.normalStep = 3 * sizeof(float);
+    }
+    const GltfAccessor &colors = primitive.colors;
+    if (colors.data && colors.componentType == GL_FLOAT)
+    {
+        streams.colors = colors.data; // Alpha, if any, is skipped by the step
+        streams.colorStep = colors.stride;
+    }
+    else if (colors.data)
+    {
+        primitive.convertedColors.resize(colors.count * 4, 1.0f);
+        for (size_t v = 0; v < colors.count; ++v)
+            for (int c = 0; c < 3; ++c)
+                primitive.convertedColors[v * 4 + c] = ReadGltfComponent(colors, v, c);
+        streams.colors = reinterpret_cast<const unsigned char *>(primitive.convertedColors.data());
+        streams.colorStep = 4 * sizeof(float);
+    }
+    const GltfAccessor &texCoords = primitive.texCoords;
+    if (texCoords.data && texCoords.componentType == GL_FLOAT)
+    {
+        streams.texCoords = texCoords.data;
+        streams.texCoordStep = texCoords.stride;
+    }
+    else if (texCoords.data)
+    {
+        primitive.convertedTexCoords.resize(texCoords.count * 2);
+        for (size_t v = 0; v < texCoords.count; ++v)
+            for (int c = 0; c < 2; ++c)
+                primitive.convertedTexCoords[v * 2 + c] = ReadGltfComponent(texCoords, v, c);
+        streams.texCoords = reinterpret_cast<const unsigned char *>(primitive.convertedTexCoords.data());
+        streams.texCoordStep = 2 * sizeof(float);
+    }
+    return streams;
+}
+
+// Whether a primitive's vertices already are 'layout' byte for byte: float attributes interleaved in one buffer view at the
+// layout's offsets, with the view covering the last vertex's full stride
+bool GltfVerticesMatchLayout(const GltfPrimitive &primitive, const VertexLayout &layout)
+{
+    const size_t stride = layout.stride();
+    auto inPlace = [&](const GltfAccessor &accessor, VertexAttributeLocation location, int components)
+    {
+        return accessor.data == primitive.positions.data + layout.offset(location) && accessor.stride == stride &&
+               accessor.componentType == GL_FLOAT && accessor.components == components;
+    };
+    return layout.format == VertexFormat::Float && primitive.positions.stride == stride &&
+           primitive.positions.available >= primitive.positions.count * stride && inPlace(primitive.normals, kNormalAttribute, 3) &&
+           (!layout.has(kColorAttribute) || inPlace(primitive.colors, kColorAttribute, 3)) &&
+           (!layout.has(kTexCoordAttribute) || inPlace(primitive.texCoords, kTexCoordAttribute, 2));
+}
+
+// Area-weighted vertex normals of a triangle mesh, for primitives that come without any
+std::vector<float> GenerateVertexNormals(const GltfAccessor &positions, const MeshData &mesh)
+{
+    std::vector<glm::vec3> sums(positions.count, glm::vec3(0.0f));
+    auto index = [&](size_t i) -> uint32_t
+    {
+        if (mesh.indexSize == sizeof(uint16_t))
+        {
+            uint16_t value;
+            std::memcpy(&value, static_cast<const unsigned char *>(mesh.indices) + i * sizeof(uint16_t), sizeof(value));
+            return value;
+        }
+        return static_cast<const unsigned int *>(mesh.indices)[i];
+    };
+    for (size_t t = 0; t + 2 < mesh.indexCount; t += 3)
+    {
+        const uint32_t a = index(t), b = index(t + 1), c = index(t + 2);
+        const glm::vec3 pa = LoadFloat3(positions.data + a * positions.stride);
+        const glm::vec3 pb = LoadFloat3(positions.data + b * positions.stride);
+        const glm::vec3 pc = LoadFloat3(positions.data + c * positions.stride);
+        const glm::vec3 normal = glm::cross(pb - pa, pc - pa); // Length is twice the area
+        sums[a] += normal;
+        sums[b] += normal;
+        sums[c] += normal;
+    }
+    std::vector<float> normals(positions.count * 3);
+    for (size_t v = 0; v < sums.size(); ++v)
+    {
+        float length = glm::length(sums[v]);
+        glm::vec3 normal = length > 0.0f ? sums[v] / length : sums[v];
+        std::memcpy(normals.data() + v * 3, glm::value_ptr(normal), sizeof(normal));
+    }
+    return normals;
+}
+
+// Local transform of a node: its matrix, or translation * rotation * scale
+glm::mat4 GltfNodeTransform(const JsonValue &node)
+{
+    const JsonValue &matrix = node["matrix"];
+    if (matrix.size() == 16)
+    {
+        glm::mat4 transform;
+        for (int c = 0; c < 4; ++c)
+            for (int r = 0; r < 4; ++r)
+                transform[c][r] = static_cast<float>(matrix.at(size_t(c * 4 + r)).asNumber(c == r ? 1.0 : 0.0)); // Column-major
+        return transform;
+    }
+    auto component = [](const JsonValue &vector, size_t i, double fallback)
+    { return static_cast<float>(vector.at(i).asNumber(fallback)); };
+    const JsonValue &t = node["translation"], &r = node["rotation"], &s = node["scale"];
+    const float x = component(r, 0, 0.0), y = component(r, 1, 0.0), z = component(r, 2, 0.0), w = component(r, 3, 1.0);
+    glm::mat4 transform(1.0f);
+    // Rotation matrix of the unit quaternion, columns scaled
+    transform[0] = glm::vec4(1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + z * w), 2.0f * (x * z - y * w), 0.0f) * component(s, 0, 1.0);
+    transform[1] = glm::vec4(2.0f * (x * y - z * w), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + x * w), 0.0f) * component(s, 1, 1.0);
+    transform[2] = glm::vec4(2.0f * (x * z + y * w), 2.0f * (y * z - x * w), 1.0f - 2.0f * (x * x + y * y), 0.0f) * component(s, 2, 1.0);
+    transform[3] = glm::vec4(component(t, 0, 0.0), component(t, 1, 0.0), component(t, 2, 0.0), 1.0f);
+    return transform;
+}
+
+// Image a material takes its color from: the base color texture, else the diffuse texture of
+// KHR_materials_pbrSpecularGlossiness (as Assimp does). -1 if none.
+int64_t GltfMaterialImage(const JsonValue &json, const JsonValue &material)
+{
+    int64_t texture = material["pbrMetallicRoughness"]["baseColorTexture"]["index"].asIndex();
+    if (texture < 0)
+        texture = material["extensions"]["KHR_materials_pbrSpecularGlossiness"]["diffuseTexture"]["index"].asIndex();
+    return texture < 0 ? -1 : json["textures"].at(size_t(texture))["source"].asIndex();
+}
+
+// Where an image's bytes are: a buffer view in the asset (embedded, 'source' set) or an external file. False for data URIs.
+bool ResolveGltfImage(const GltfAsset &asset, int64_t image, const std::string &directory, const std::string &modelPath,
+                      TextureDecodeRequest &request)
+{
+    const JsonValue &entry = asset.json["images"].at(size_t(image));
+    const std::string &uri = entry["uri"].string;
+    if (uri.rfind("data:", 0) == 0)
+        return false;
+    if (!uri.empty())
+    {
+        request.key = TextureCacheKey(DecodeUri(uri), directory, modelPath);
+        return true;
+    }
+    // Keys of embedded images name the image index; the "image" prefix keeps them apart from Assimp's texture indices
+    request.key = modelPath + "*image" + std::to_string(image);
+    request.embedded = true;
+    const JsonValue &view = asset.json["bufferViews"].at(size_t(entry["bufferView"].asIndex()));
+    const int64_t buffer = view["buffer"].asIndex();
+    const size_t offset = size_t(view["byteOffset"].asIndex(0)), length = size_t(view["byteLength"].asIndex(0));
+    if (buffer >= 0 && size_t(buffer) < asset.buffers.size() && offset <= asset.buffers[size_t(buffer)].size &&
+        length <= asset.buffers[size_t(buffer)].size - offset && length <= std::numeric_limits<unsigned int>::max())
+    {
+        request.source.data = asset.buffers[size_t(buffer)].data + offset; // Decoded in place, height 0 = compressed bytes
+        request.source.width = static_cast<unsigned int>(length);
+    }
+    return true;
+}
+
+// Places every mesh at the nodes that reference it (see MeshData::instanceCount): one reference is baked into the vertices,
+// several make the mesh instanced. 'bakedTransforms' is sized here and must outlive 'bakes'.
+void AssignMeshInstances(ModelData &model, const std::vector<std::vector<glm::mat4>> &meshInstances,
+                         std::vector<VertexTransform> &bakedTransforms, std::vector<const VertexTransform *> &bakes)
+{
+    bakedTransforms.assign(meshInstances.size(), VertexTransform{});
+    bakes.assign(meshInstances.size(), nullptr); // nullptr = vertices stay as imported
+    size_t instancedMeshes = 0;
+    for (size_t i = 0; i < meshInstances.size(); ++i)
+    {
+        MeshData &meshData = model.meshes[i];
+        const std::vector<glm::mat4> &instances = meshInstances[i];
+        meshData.instanceCount = static_cast<uint32_t>(instances.size());
+        if (instances.size() == 1 && instances[0] != glm::mat4(1.0f))
+        {
+            bakedTransforms[i].position = instances[0];
+            bakedTransforms[i].normal = glm::transpose(glm::inverse(glm::mat3(instances[0])));
+            bakes[i] = &bakedTransforms[i];
+        }
+        else if (instances.size() > 1)
+        {
+            meshData.firstInstance = static_cast<uint32_t>(model.instanceTransforms.size());
+            model.instanceTransforms.insert(model.instanceTransforms.end(), instances.begin(), instances.end());
+            instancedMeshes++;
+        }
+    }
+    if (instancedMeshes > 0)
+        spdlog::info("{} meshes are drawn instanced ({} instances)", instancedMeshes, model.instanceTransforms.size());
+}
+
+// Loads a glTF 2.0 file without Assimp (see above). Returns std::nullopt if the file needs Assimp, otherwise the model
+// (nullptr if the load was cancelled). The mesh cache is only written when the load settings add processing worth caching.
+std::optional<std::unique_ptr<ModelData>> loadGltfModelData(const std::string &path, const std::string &directory,
+                                                             const LoadSettings &settings, const SourceFileStamp &stamp,
+                                                             const std::filesystem::path &cachePath, LoadCancelToken cancel)
+{
+    GltfAsset asset;
+    std::string unsupported;
+    auto importThroughAssimp = [&]()
+    {
+        spdlog::info("Importing '{}' through Assimp: {}", path, unsupported);
+        return std::nullopt;
+    };
+    if (!OpenGltfAsset(path, directory, asset, unsupported))
+        return importThroughAssimp();
+    const JsonValue &json = asset.json;
+
+    // Every primitive becomes a mesh; the primitives of a glTF mesh share its node references
+    const JsonValue &meshes = json["meshes"];
+    std::vector<GltfPrimitive> primitives;
+    for (size_t m = 0; m < meshes.size(); ++m)
+    {
+        const JsonValue &sources = meshes.at(m)["primitives"];
+        for (size_t p = 0; p < sources.size(); ++p)
+        {
+            GltfPrimitive primitive;
+            primitive.mesh = m;
+            if (!ResolveGltfPrimitive(asset, sources.at(p), primitive, unsupported))
+                return importThroughAssimp();
+            primitives.push_back(std::move(primitive));
+        }
+    }
+
+    // Material images, resolved up front so a data URI still falls back before any work is done
+    const JsonValue &materials = json["materials"];
+    std::vector<TextureDecodeRequest> materialImages(materials.size());
+    std::vector<bool> textured(materials.size() + 1, false); // One more for primitives without a material
+    for (size_t m = 0; m < materials.size(); ++m)
+    {
+        int64_t image = GltfMaterialImage(json, materials.at(m));
+        if (image < 0)
+            continue;
+        if (!ResolveGltfImage(asset, image, directory, path, materialImages[m]))
+        {
+            unsupported = "data URI image";
+            return importThroughAssimp();
+        }
+        textured[m] = true;
+    }
+
+    // --- Flatten the node hierarchy of the default scene into world transforms per primitive ---
+    const JsonValue &nodes = json["nodes"];
+    const JsonValue &scene = json["scenes"].at(size_t(json["scene"].asIndex(0)));
+    if (scene.type != JsonValue::Type::Object)
+    {
+        unsupported = "no scene to show";
+        return importThroughAssimp();
+    }
+    std::vector<std::vector<glm::mat4>> meshInstances(meshes.size());
+    {
+        std::vector<std::pair<int64_t, glm::mat4>> pending;
+        const JsonValue &roots = scene["nodes"];
+        for (size_t r = roots.size(); r-- > 0;) // Reversed, so nodes are visited in order
+            pending.emplace_back(roots.at(r).asIndex(), glm::mat4(1.0f));
+        size_t visited = 0;
+        while (!pending.empty())
+        {
+            auto [index, parentTransform] = pending.back();
+            pending.pop_back();
+            const JsonValue &node = nodes.at(size_t(index));
+            if (node.type != JsonValue::Type::Object || ++visited > nodes.size())
+            {
+                unsupported = "invalid node hierarchy"; // Including cycles, which visit some node twice
+                return importThroughAssimp();
+            }
+            glm::mat4 world = parentTransform * GltfNodeTransform(node);
+            const int64_t mesh = node["mesh"].asIndex();
+            if (mesh >= 0 && size_t(mesh) < meshes.size())
+                meshInstances[size_t(mesh)].push_back(world);
+            const JsonValue &children = node["children"];
+            for (size_t c = children.size(); c-- > 0;)
+                pending.emplace_back(children.at(c).asIndex(), world);
+        }
+    }
+
+    auto model = std::make_unique<ModelData>();
+    model->path = path;
+    model->constantColor = settings.defaultColor;
+    model->meshes.resize(primitives.size());
+    std::vector<std::vector<glm::mat4>> primitiveInstances(primitives.size());
+    for (size_t i = 0; i < primitives.size(); ++i)
+        primitiveInstances[i] = meshInstances[primitives[i].mesh];
+    std::vector<VertexTransform> bakedTransforms;
+    std::vector<const VertexTransform *> bakes;
+    AssignMeshInstances(*model, primitiveInstances, bakedTransforms, bakes);
+
+    // Same layout rules as for Assimp meshes
+    auto materialIndex = [&](const GltfPrimitive &primitive)
+    {
+        return primitive.material >= 0 && size_t(primitive.material) < materials.size() ? size_t(primitive.material) : materials.size();
+    };
+    uint32_t attributes = 0;
+    for (size_t i = 0; i < primitives.size(); ++i)
+    {
+        if (model->meshes[i].instanceCount == 0)
+            continue;
+        if (primitives[i].colors.data)
+            attributes |= kVertexColors;
+        if (primitives[i].texCoords.data && textured[materialIndex(primitives[i])])
+            attributes |= kVertexTexCoords;
+    }
+    const VertexLayout layout{settings.vertexFormat, attributes};
+    spdlog::info("Vertex layout: {} bytes per vertex{}{}", layout.stride(), layout.has(kColorAttribute) ? "" : ", constant color",
+                 layout.has(kTexCoordAttribute) ? "" : ", no texture coordinates");
+
+    // --- Indices, then vertices: used in place where the file already has the final data, packed otherwise ---
+    // Indices are only used in place when nothing rewrites them later (no optimization or detail levels, no chunking).
+    const bool indicesInPlace = !settings.optimizeMeshes && !settings.generateLods;
+    std::vector<VertexStreams> streams(primitives.size());
+    std::vector<char> invalid(primitives.size(), 0); // Per primitive (char rather than bool so workers can write concurrently)
+    WorkerPool &pool = GetWorkerPool();
+    pool.parallelFor(primitives.size(), [&](size_t i)
+                     {
+        GltfPrimitive &primitive = primitives[i];
+        MeshData &meshData = model->meshes[i];
+        if (meshData.instanceCount == 0 || cancel.cancelled())
+            return;
+        meshData.materialIndex = static_cast<unsigned int>(materialIndex(primitive));
+        meshData.layout = layout;
+        meshData.vertexCount = primitive.positions.count;
+
+        const GltfAccessor &indices = primitive.indices;
+        if (indices.data && indicesInPlace && indices.componentType == GL_UNSIGNED_SHORT && indices.stride == sizeof(uint16_t) &&
+            meshData.vertexCount <= kMaxShortIndexVertices)
+        {
+            meshData.indices = indices.data;
+            meshData.indexSize = sizeof(uint16_t);
+        }
+        else
+        {
+            meshData.indexStorage.resize(indices.data ? indices.count : meshData.vertexCount);
+            for (size_t k = 0; k < meshData.indexStorage.size(); ++k)
+                meshData.indexStorage[k] = indices.data ? ReadGltfIndex(indices, k) : static_cast<unsigned int>(k);
+            meshData.indices = meshData.indexStorage.data();
+        }
+        meshData.indexCount = indices.data ? indices.count : meshData.vertexCount;
+        // Every later stage trusts the indices, as Assimp's ValidateDataStructure would have checked them
+        for (size_t k = 0; k < meshData.indexCount; ++k)
+        {
+            uint32_t index = meshData.indexSize == sizeof(uint16_t) ? ReadGltfIndex(indices, k) : meshData.indexStorage[k];
+            if (index >= meshData.vertexCount)
+            {
+                invalid[i] = 1;
+                return;
+            }
+        }
+
+        if (!primitive.normals.data)
+            primitive.generatedNormals = GenerateVertexNormals(primitive.positions, meshData);
+        streams[i] = GltfVertexStreams(primitive);
+        if (!bakes[i] && GltfVerticesMatchLayout(primitive, layout))
+            meshData.vertices = primitive.positions.data;
+        else
+        {
+            meshData.vertexStorage.resize(meshData.vertexCount * layout.stride());
+            meshData.vertices = meshData.vertexStorage.data();
+        } });
+    if (cancel.cancelled())
+        return nullptr;
+    if (std::find(invalid.begin(), invalid.end(), 1) != invalid.end())
+    {
+        unsupported = "index out of range";
+        return importThroughAssimp();
+    }
+    size_t verticesInPlace = 0, indicesInPlaceMeshes = 0; // Meshes whose vertices / indices point into the file
+    for (const MeshData &meshData : model->meshes)
+    {
+        verticesInPlace += meshData.instanceCount > 0 && meshData.vertexStorage.empty() && meshData.vertexCount > 0 ? 1 : 0;
+        indicesInPlaceMeshes += meshData.instanceCount > 0 && meshData.indexSize == sizeof(uint16_t) ? 1 : 0;
+    }
+
+    if (!PackMeshVertices(*model, 0, primitives.size(), streams, bakes, settings.defaultColor, nullptr, nullptr, cancel))
+        return nullptr;
+    MeshPostProcessor postProcessor(settings, std::vector<bool>(primitives.size(), true));
+    if (!postProcessor.run(*model, 0, primitives.size(), cancel))
+        return nullptr;
+    model->meshes = postProcessor.take(0, primitives.size());
+    postProcessor.finish();
+    SelectOccluders(model->meshes, 0, model->meshes.size(), ExtractPackedOccluder, model->occluders);
+    spdlog::info("Loaded '{}' without Assimp: {} primitives, {} with vertices and {} with indices used in place", path,
+                 primitives.size(), verticesInPlace, indicesInPlaceMeshes);
+
+    // Material textures, embedded images decoded straight from the buffer
+    TextureRequestSet requestSet;
+    std::vector<size_t> requestIndex(materials.size());
+    for (size_t m = 0; m < materials.size(); ++m)
+        if (textured[m])
+            requestIndex[m] = requestSet.add(materialImages[m]);
+    requestSet.decodePending(model->textures, cancel);
+    if (cancel.cancelled())
+        return nullptr;
+    model->materialTextureKeys.resize(materials.size() + 1);
+    for (size_t m = 0; m < materials.size(); ++m)
+        if (textured[m] && requestSet.isUsable(requestIndex[m]))
+            model->materialTextureKeys[m].push_back(requestSet.key(requestIndex[m]));
+
+    // Without processing, reading the file again is as fast as reading a cache entry, so only processed models are cached
+    if (!cachePath.empty() && !model->meshes.empty() && MeshCachePackFlags(settings) != 0)
+    {
+        auto findEmbedded = [&](const std::string &name, EmbeddedTextureSource &embedded)
+        {
+            TextureDecodeRequest request;
+            const int64_t image = name.rfind("*image", 0) == 0 ? std::strtoll(name.c_str() + 6, nullptr, 10) : -1;
+            if (image < 0 || !ResolveGltfImage(asset, image, directory, path, request) || !request.source.data)
+                return false;
+            embedded = request.source;
+            return true;
+        };
+        writeMeshCache(cachePath, stamp, HashFileContents(*asset.files[0]), settings, *model, findEmbedded);
+    }
+    model->mappings = std::move(asset.files);
+    return model;
+}
+
+// Imports a model and packs its meshes and textures into CPU buffers, or its meshes straight into the geometry arena
+// mapped through 'geometry' when nothing rewrites them after packing (see below).
+// Runs on a background thread: no OpenGL calls. Returns nullptr if the load was cancelled.
+std::unique_ptr<ModelData> loadModelData(const std::string &path, const std::string &directory, const LoadSettings &settings,
+                                         GeometryChannel *geometry, LoadCancelToken cancel)
+{
+    // A valid mesh cache entry skips Assimp and the packing stage altogether
+    SourceFileStamp stamp;
+    bool haveStamp = GetSourceFileStamp(path, stamp);
+    std::filesystem::path cachePath = haveStamp ? MeshCachePath(path) : std::filesystem::path();
+    if (!cachePath.empty())
+    {
+        if (std::unique_ptr<ModelData> cached = readMeshCache(cachePath, path, stamp, settings, cancel))
+        {
+            spdlog::info("Loaded '{}' from mesh cache: {}", path, cachePath.string());
+            SelectOccluders(cached->meshes, 0, cached->meshes.size(), ExtractPackedOccluder, cached->occluders);
+            return cached;
+        }
+    }
+    if (cancel.cancelled())
+        return nullptr;
+    if (settings.nativeGltf && IsGltfPath(path))
+    {
+        if (std::optional<std::unique_ptr<ModelData>> native = loadGltfModelData(path, directory, settings, stamp, cachePath, cancel))
+            return std::move(*native);
+    }
+
+    auto model = std::make_unique<ModelData>();
+    model->path = path;
+    model->constantColor = settings.defaultColor;
+
+    // The cache entry records the source's content hash. It is computed on the pool while Assimp imports the file
+    // (single-threaded, so the pool is otherwise idle), rather than after packing, on the way to delivering the model.
+    std::future<std::optional<uint64_t>> sourceHash;
+    if (!cachePath.empty())
+        sourceHash = std::async(std::launch::async, [path]() -> std::optional<uint64_t>
+                                {
+            std::unique_ptr<MappedFile> source = MappedFile::open(path);
+            if (!source)
+                return std::nullopt;
+            return HashFileContents(*source); });
+
+    Assimp::Importer importer;
+    importer.SetProgressHandler(new CancelProgressHandler(cancel)); // Importer takes ownership
+    importer.SetIOHandler(new MappedIOSystem(directory));           // Likewise
+    const aiScene *scene = importer.ReadFile(path, // 'path' is the full model path
+                                             aiProcess_Triangulate |
+                                                 aiProcess_GenSmoothNormals |
+                                                 aiProcess_FlipUVs | // Often needed as OpenGL UVs origin (0,0) is bottom-left
+                                                 aiProcess_JoinIdenticalVertices |
+                                                 aiProcess_ValidateDataStructure);
+    if (cancel.cancelled())
+        return nullptr;
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+    {
+        spdlog::error("Failed to load model '{}': {}", path, importer.GetErrorString());
+        return model; // Empty model signals failure
+    }
+    // Low-memory mode takes the scene over from the importer, so its meshes can be freed as soon as they are packed
+    std::unique_ptr<aiScene> ownedScene;
+    if (settings.lowMemory)
+    {
+        ownedScene.reset(importer.GetOrphanedScene());
+        scene = ownedScene.get();
+    }
+
+    // --- Flatten the node hierarchy into world transforms per mesh ---
+    // A mesh referenced by one node gets that transform baked into its vertices; meshes referenced by several
+    // nodes keep local vertices and are drawn instanced, so repeated parts cost one copy of geometry.
+    model->meshes.resize(scene->mNumMeshes);
+    std::vector<std::vector<glm::mat4>> meshInstances(scene->mNumMeshes);
+    {
+        std::vector<std::pair<const aiNode *, glm::mat4>> pending{{scene->mRootNode, glm::mat4(1.0f)}};
+        while (!pending.empty())
+        {
+            auto [node, parentTransform] = pending.back();
+            pending.pop_back();
+            glm::mat4 world = parentTransform * AssimpToGlm(node->mTransformation);
+            for (unsigned int m = 0; m < node->mNumMeshes; ++m)
+                if (node->mMeshes[m] < scene->mNumMeshes)
+                    meshInstances[node->mMeshes[m]].push_back(world);
+            for (unsigned int c = node->mNumChildren; c-- > 0;) // Reversed, so children are visited in order
+                pending.emplace_back(node->mChildren[c], world);
+        }
+    }
+    std::vector<VertexTransform> bakedTransforms;
+    std::vector<const VertexTransform *> bakes;
+    AssignMeshInstances(*model, meshInstances, bakedTransforms, bakes);
+
+    // Primitive types are read up front: in low-memory mode the source meshes are gone before the later stages run
+    std::vector<bool> triangleMeshes(scene->mNumMeshes);
+    for (unsigned int i = 0; i < scene->mNumMeshes; ++i)
+        triangleMeshes[i] = scene->mMeshes[i]->mPrimitiveTypes == aiPrimitiveType_TRIANGLE;
+
+    // The vertex layout only stores colors if some mesh has them, and UVs if some mesh has them and a texture to use them
+    uint32_t attributes = 0;
+    for (unsigned int i = 0; i < scene->mNumMeshes; ++i)
+    {
+        const aiMesh *mesh_ptr = scene->mMeshes[i];
+        if (model->meshes[i].instanceCount == 0)
+            continue;
+        if (mesh_ptr->HasVertexColors(0))
+            attributes |= kVertexColors;
+        const aiMaterial *material = mesh_ptr->mMaterialIndex < scene->mNumMaterials ? scene->mMaterials[mesh_ptr->mMaterialIndex] : nullptr;
+        if (mesh_ptr->HasTextureCoords(0) && material &&
+            material->GetTextureCount(aiTextureType_DIFFUSE) + material->GetTextureCount(aiTextureType_BASE_COLOR) > 0)
+            attributes |= kVertexTexCoords;
+    }
+    const VertexLayout layout{settings.vertexFormat, attributes};
+    spdlog::info("Vertex layout: {} bytes per vertex{}{}", layout.stride(), layout.has(kColorAttribute) ? "" : ", constant color",
+                 layout.has(kTexCoordAttribute) ? "" : ", no texture coordinates");
+
+    auto faceIndexCount = [&](unsigned int i)
+    {
+        const aiMesh *mesh_ptr = scene->mMeshes[i];
+        if (triangleMeshes[i])
+            return static_cast<size_t>(mesh_ptr->mNumFaces) * 3;
+        size_t indexCount = 0;
+        for (unsigned int f = 0; f < mesh_ptr->mNumFaces; f++)
+            indexCount += mesh_ptr->mFaces[f].mNumIndices;
+        return indexCount;
+    };
+
+    // Without optimization and detail levels, and with no triangle mesh too large for 16-bit indices (nothing to chunk),
+    // packing produces the final meshes. They are then packed straight into the mapped geometry arena at offsets laid out
+    // here, so no packed copy is made in memory; bounding spheres, occluders and the cache entry are taken from the source.
+    // The other modes rewrite the packed meshes, so they pack into memory and the GL thread copies the result.
+    bool packIntoArena = geometry && !settings.optimizeMeshes && !settings.generateLods;
+    for (unsigned int i = 0; i < scene->mNumMeshes && packIntoArena; ++i)
+        packIntoArena = model->meshes[i].instanceCount == 0 || !triangleMeshes[i] || scene->mMeshes[i]->mNumVertices <= kMaxShortIndexVertices;
+    // In low-memory mode the other modes hand each finished batch to the GL thread instead, which appends it to the arena
+    // and frees it, so the packed copy never holds the whole model either. Their final size is not known up front
+    // (chunking duplicates vertices, detail levels add indices), so the arena is sized from the source and grows if needed.
+    const bool streamBatches = geometry && settings.lowMemory && !packIntoArena;
+    GeometryMapping mapping;
+    if (packIntoArena || streamBatches)
+    {
+        GeometryChannel::Request request{layout, settings.defaultColor, 0, 0, streamBatches};
+        for (unsigned int i = 0; i < scene->mNumMeshes; ++i)
+        {
+            MeshData &meshData = model->meshes[i];
+            if (meshData.instanceCount == 0)
+                continue;
+            const size_t vertexCount = scene->mMeshes[i]->mNumVertices;
+            const size_t indexCount = faceIndexCount(i);
+            const size_t indexSize = vertexCount <= kMaxShortIndexVertices ? sizeof(uint16_t) : sizeof(uint32_t); // As narrowIndices
+            if (packIntoArena)
+            {
+                meshData.vertexCount = vertexCount;
+                meshData.indexCount = indexCount;
+                meshData.indexSize = indexSize;
+                meshData.arenaVertexOffset = request.vertexBytes;
+                meshData.arenaIndexOffset = AlignArenaIndexOffset(request.indexBytes);
+            }
+            request.vertexBytes += vertexCount * layout.stride();
+            request.indexBytes = AlignArenaIndexOffset(request.indexBytes) + indexCount * indexSize;
+        }
+        if (!geometry->map(request, mapping, cancel))
+            return nullptr;
+        if (packIntoArena)
+        {
+            packIntoArena = mapping.vertices && mapping.indices; // Otherwise packed into memory and uploaded with glBufferSubData
+            for (MeshData &meshData : model->meshes)
+            {
+                meshData.inArena = packIntoArena && meshData.instanceCount > 0;
+                meshData.indexSize = meshData.inArena ? meshData.indexSize : sizeof(uint32_t);
+            }
+        }
+    }
+
+    // Process materials and textures (simplified: only decodes diffuse textures)
+    // Pass the Assimp scene pointer and the original model path for embedded texture handling.
+    // This comes before packing, so nothing needs the scene after the last batch and low-memory mode can destroy it then.
+    decodeSceneMaterialTextures(scene, directory, path, *model, cancel);
+    if (cancel.cancelled())
+        return nullptr;
+
+    // Meshes go into the cache entry as they are finished, since in low-memory mode their sources do not outlive their batch
+    std::vector<VertexStreams> streams(scene->mNumMeshes);
+    MeshCacheWriter cacheWriter;
+    if (!cachePath.empty())
+        cacheWriter.open(cachePath);
+    // Likewise the embedded images the entry stores are copied while the scene exists
+    struct EmbeddedCopy
+    {
+        std::vector<unsigned char> bytes;
+        unsigned int width = 0, height = 0;
+    };
+    std::unordered_map<std::string, EmbeddedCopy> embeddedCopies; // By name after the model path, e.g. "*0"
+    if (ownedScene && cacheWriter.isOpen())
+    {
+        for (const auto &materialKeys : model->materialTextureKeys)
+        {
+            for (const std::string &key : materialKeys)
+            {
+                if (key.size() <= path.size() || key.compare(0, path.size(), path) != 0 || key[path.size()] != '*')
+                    continue; // External file
+                const std::string name = key.substr(path.size());
+                const aiTexture *texture = embeddedCopies.count(name) ? nullptr : FindEmbeddedTexture(name, scene);
+                if (!texture)
+                    continue;
+                EmbeddedCopy &copy = embeddedCopies[name];
+                const unsigned char *data = reinterpret_cast<const unsigned char *>(texture->pcData);
+                copy.bytes.assign(data, data + (texture->mHeight == 0 ? texture->mWidth : static_cast<size_t>(texture->mWidth) * texture->mHeight * 4));
+                copy.width = texture->mWidth;
+                copy.height = texture->mHeight;
+            }
+        }
+    }
+    auto sourcePosition = [&](size_t i, size_t v)
+    {
+        const VertexStreams &source = streams[i];
+        return StoredPosition(model->meshes[i], TransformedPosition(LoadFloat3(source.positions + v * source.positionStep), bakes[i]));
+    };
+    auto extractSourceOccluder = [&](const MeshData &meshData, size_t i, Occluder &occluder)
+    {
+        occluder.positions.resize(meshData.vertexCount);
+        for (size_t v = 0; v < meshData.vertexCount; ++v)
+            occluder.positions[v] = sourcePosition(i, v);
+        occluder.indices.resize(meshData.indexCount);
+        packMeshIndices(scene->mMeshes[i], 0, scene->mMeshes[i]->mNumFaces, occluder.indices.data());
+    };
+    // Meshes packed into the arena get their cache room reserved before packing; each range is then packed once into a
+    // scratch buffer that goes both into the (write-only) mapping and into the cache file, from the pool threads
+    std::vector<size_t> cacheEntries(scene->mNumMeshes);
+    const bool cacheFromArena = packIntoArena && cacheWriter.isOpen();
+    PackedVertexSink cacheVertices;
+    if (cacheFromArena)
+        cacheVertices = [&](size_t i, unsigned int begin, const unsigned char *data, size_t bytes)
+        { cacheWriter.writeAt(cacheWriter.vertexOffset(cacheEntries[i]) + static_cast<uint64_t>(begin) * layout.stride(), data, bytes); };
+
+    // Meshes are packed, optimized and chunked in batches: normally one batch of everything, in low-memory mode batches of
+    // about kLowMemoryBatchVertices source vertices whose Assimp meshes are freed right after packing, and which are then
+    // streamed to the GL thread. That way the scene and the packed copy never both hold the whole model.
+    WorkerPool &pool = GetWorkerPool();
+    MeshPostProcessor postProcessor(settings, triangleMeshes);
+    std::vector<MeshData> packedMeshes; // Final meshes in order, moved out of model->meshes batch by batch
+    size_t finishedMeshes = 0;          // Including the ones streamed to the GL thread
+    for (unsigned int batchBegin = 0, batchEnd = 0; batchBegin < scene->mNumMeshes; batchBegin = batchEnd)
+    {
+        size_t batchVertices = scene->mMeshes[batchBegin]->mNumVertices;
+        batchEnd = batchBegin + 1;
+        while (batchEnd < scene->mNumMeshes &&
+               (!settings.lowMemory || batchVertices + scene->mMeshes[batchEnd]->mNumVertices <= kLowMemoryBatchVertices))
+            batchVertices += scene->mMeshes[batchEnd++]->mNumVertices;
+
+        // --- Parallel packing: size every mesh first, then fill fixed vertex/index ranges concurrently ---
+        // Meshes no node references are skipped; meshes packed into the arena were sized above.
+        pool.parallelFor(batchEnd - batchBegin, [&](size_t k)
+                         {
+            const size_t i = batchBegin + k;
+            const aiMesh *mesh_ptr = scene->mMeshes[i];
+            MeshData &meshData = model->meshes[i];
+            if (meshData.instanceCount == 0)
+                return;
+            streams[i] = AssimpVertexStreams(mesh_ptr);
+            meshData.materialIndex = mesh_ptr->mMaterialIndex;
+            meshData.layout = layout;
+            if (meshData.inArena)
+                return;
+            meshData.vertexStorage.resize(static_cast<size_t>(mesh_ptr->mNumVertices) * layout.stride());
+            meshData.vertices = meshData.vertexStorage.data();
+            meshData.vertexCount = mesh_ptr->mNumVertices;
+            meshData.indexStorage.resize(faceIndexCount(static_cast<unsigned int>(i)));
+            meshData.indices = meshData.indexStorage.data();
+            meshData.indexCount = meshData.indexStorage.size(); });
+        if (cancel.cancelled())
+            return nullptr;
+
+        if (cacheFromArena)
+        {
+            for (unsigned int i = batchBegin; i < batchEnd; ++i)
+                if (model->meshes[i].instanceCount > 0)
+                    cacheEntries[i] = cacheWriter.reserveMesh(model->meshes[i]);
+        }
+        if (!PackMeshVertices(*model, batchBegin, batchEnd, streams, bakes, settings.defaultColor, mapping.vertices, cacheVertices, cancel))
+            return nullptr;
+
+        // Faces can only be split into ranges when their index offsets are known, i.e. for pure triangle meshes
+        struct FaceRange
+        {
+            unsigned int mesh;
+            unsigned int begin, end;
+        };
+        std::vector<FaceRange> faceRanges;
+        for (unsigned int i = batchBegin; i < batchEnd; ++i)
+        {
+            const aiMesh *mesh_ptr = scene->mMeshes[i];
+            if (model->meshes[i].instanceCount == 0)
+                continue;
+            unsigned int faceStep = triangleMeshes[i] ? kPackRangeSize : mesh_ptr->mNumFaces;
+            for (unsigned int f = 0; f < mesh_ptr->mNumFaces; f += faceStep)
+                faceRanges.push_back({i, f, std::min(f + faceStep, mesh_ptr->mNumFaces)});
+        }
+        pool.parallelFor(faceRanges.size(), [&](size_t r)
+                         {
+            const FaceRange &range = faceRanges[r];
+            const aiMesh *mesh_ptr = scene->mMeshes[range.mesh];
+            const MeshData &meshData = model->meshes[range.mesh];
+            const size_t first = static_cast<size_t>(range.begin) * 3; // Only non-zero for triangle meshes
+            if (cancel.cancelled())
+                return;
+            unsigned char *arenaIndices = meshData.inArena ? mapping.indices + meshData.arenaIndexOffset + first * meshData.indexSize : nullptr;
+            if (!meshData.inArena)
+            {
+                packMeshIndices(mesh_ptr, range.begin, range.end, model->meshes[range.mesh].indexStorage.data() + first);
+            }
+            else if (cacheFromArena)
+            {
+                // Like the vertices: packed once, then copied to the mapping and the cache
+                const size_t capacity = triangleMeshes[range.mesh] ? static_cast<size_t>(range.end - range.begin) * 3 : meshData.indexCount;
+                std::unique_ptr<unsigned char[]> scratch(new unsigned char[capacity * meshData.indexSize]);
+                const size_t bytes = meshData.indexSize * (meshData.indexSize == sizeof(uint16_t)
+                                                               ? packMeshIndices(mesh_ptr, range.begin, range.end, reinterpret_cast<uint16_t *>(scratch.get()))
+                                                               : packMeshIndices(mesh_ptr, range.begin, range.end, reinterpret_cast<uint32_t *>(scratch.get())));
+                std::memcpy(arenaIndices, scratch.get(), bytes);
+                cacheWriter.writeAt(cacheWriter.indexOffset(cacheEntries[range.mesh]) + first * meshData.indexSize, scratch.get(), bytes);
+            }
+            else if (meshData.indexSize == sizeof(uint16_t))
+            {
+                packMeshIndices(mesh_ptr, range.begin, range.end, reinterpret_cast<uint16_t *>(arenaIndices));
+            }
+            else
+            {
+                packMeshIndices(mesh_ptr, range.begin, range.end, reinterpret_cast<uint32_t *>(arenaIndices));
+            } });
+        if (cancel.cancelled())
+            return nullptr;
+
+        std::vector<MeshData> batchMeshes;
+        if (packIntoArena)
+        {
+            // The mapping is write-only, so everything else is computed from the source before it is freed
+            pool.parallelFor(batchEnd - batchBegin, [&](size_t k)
+                             {
+                const size_t i = batchBegin + k;
+                if (!cancel.cancelled() && model->meshes[i].instanceCount > 0)
+                    FitBoundingSphere(model->meshes[i], [&](size_t v)
+                                      { return sourcePosition(i, v); }); });
+            if (cancel.cancelled())
+                return nullptr;
+            SelectOccluders(model->meshes, batchBegin, batchEnd, extractSourceOccluder, model->occluders);
+            for (unsigned int i = batchBegin; i < batchEnd; ++i)
+            {
+                if (model->meshes[i].instanceCount == 0)
+                    continue;
+                if (cacheFromArena)
+                    cacheWriter.describeMesh(cacheEntries[i], model->meshes[i]);
+                batchMeshes.push_back(std::move(model->meshes[i]));
+            }
+        }
+
+        if (ownedScene)
+        {
+            // Everything from here on works on the packed copy
+            for (unsigned int i = batchBegin; i < batchEnd; ++i)
+            {
+                delete ownedScene->mMeshes[i];
+                ownedScene->mMeshes[i] = nullptr;
+            }
+        }
+
+        if (!packIntoArena)
+        {
+            if (!postProcessor.run(*model, batchBegin, batchEnd, cancel))
+                return nullptr;
+            batchMeshes = postProcessor.take(batchBegin, batchEnd);
+            SelectOccluders(batchMeshes, 0, batchMeshes.size(), ExtractPackedOccluder, model->occluders);
+            if (cacheWriter.isOpen())
+                for (const MeshData &meshData : batchMeshes)
+                    cacheWriter.addMesh(meshData, meshData.vertices, meshData.indices);
+        }
+        finishedMeshes += batchMeshes.size();
+        if (streamBatches)
+        {
+            geometry->push(std::move(batchMeshes)); // The GL thread fills in model->meshes when it delivers the load
+            continue;
+        }
+        for (MeshData &meshData : batchMeshes)
+            packedMeshes.push_back(std::move(meshData));
+    }
+    model->meshes = std::move(packedMeshes);
+    if (ownedScene)
+    {
+        ownedScene.reset(); // Only the embedded images the cache entry needs are left, copied above
+        scene = nullptr;
+    }
+    if (packIntoArena)
+        spdlog::info("Packed {} meshes straight into the mapped geometry buffers", finishedMeshes);
+    else
+        postProcessor.finish();
+
+    // Complete the cache entry for the next load of this file
+    if (cacheWriter.isOpen() && finishedMeshes > 0)
+    {
+        if (std::optional<uint64_t> hash = sourceHash.get())
+        {
+            auto findEmbedded = [&](const std::string &name, EmbeddedTextureSource &embedded)
+            {
+                if (!scene)
+                {
+                    auto it = embeddedCopies.find(name);
+                    if (it == embeddedCopies.end())
+                        return false;
+                    embedded = {it->second.bytes.data(), it->second.width, it->second.height};
+                    return true;
+                }
+                const aiTexture *texture = FindEmbeddedTexture(name, scene);
+                if (!texture)
+                    return false;
+                embedded.data = reinterpret_cast<const unsigned char *>(texture->pcData);
+                embedded.width = texture->mWidth;
+                embedded.height = texture->mHeight;
+                return true;
+            };
+            cacheWriter.finish(stamp, *hash, settings, *model, findEmbedded);
+        }
+    }
+    return model;
+}
+
+// One VAO with the vertex and index buffer it reads
+struct GeometryBuffers
+{
+    GLuint VAO = 0, VBO = 0, EBO = 0;
+};
+
+// Shared vertex/index buffers that every mesh of the current model is suballocated from. They are double-buffered: the
+// current model draws from the front buffers while the next one is written into the back buffers, which stay mapped from
+// begin() to finish() so a loader thread can pack straight into them (a mapped pointer is plain memory). finish() swaps
+// the two and releases the old front storage; the GL objects themselves are kept across model swaps. Meshes stored on
+// the GL thread grow the back buffers when they outrun the size given to begin(), so that may be an estimate.
+struct GeometryArena
+{
+    GeometryBuffers front, back;
+    GLuint instanceBuffer = 0, instanceTexture = 0; // Instance transforms, read by the vertex shader as a buffer texture
+    size_t vertexCapacity = 0, indexCapacity = 0;   // Back buffer sizes in bytes
+    size_t vertexUsed = 0, indexUsed = 0;           // Bytes filled since begin
+    unsigned char *vertexMapping = nullptr;         // Write-only mappings of the back buffers between begin and finish,
+    unsigned char *indexMapping = nullptr;          // nullptr if mapping failed (store then falls back to glBufferSubData)
+    size_t vertexMapStart = 0, indexMapStart = 0;   // Buffer offsets the mappings start at; non-zero once grown
+    bool filling = false;                           // Between begin and finish or abandon
+    bool contentsLost = false;                      // A mapping given up while growing had lost its contents
+    VertexLayout layout;
+    glm::vec3 constantColor{0.8f};
+
+    // Allocates back buffers of the given byte sizes for the next model and maps them; the front buffers keep drawing
+    void begin(const VertexLayout &vertexLayout, const glm::vec3 &color, size_t vertexBytes, size_t indexBytes)
+    {
+        if (back.VAO == 0)
+        {
+            for (GeometryBuffers *buffers : {&front, &back})
+            {
+                glGenVertexArrays(1, &buffers->VAO);
+                glGenBuffers(1, &buffers->VBO);
+                glGenBuffers(1, &buffers->EBO);
+            }
+        }
+        if (filling)
+            unmap();
+        layout = vertexLayout;
+        constantColor = color;
+        vertexCapacity = vertexBytes;
+        indexCapacity = indexBytes;
+        vertexMapping = allocate(back.VBO, vertexBytes);
+        indexMapping = allocate(back.EBO, indexBytes);
+        if ((vertexBytes > 0 && !vertexMapping) || (indexBytes > 0 && !indexMapping))
+            spdlog::warn("Could not map the geometry buffers, uploading with glBufferSubData");
+        vertexUsed = indexUsed = 0;
+        vertexMapStart = indexMapStart = 0;
+        filling = true;
+        contentsLost = false;
+    }
+
+    // Copies a mesh behind everything stored so far, growing the back buffers if it does not fit, records where it went
+    // (MeshData::inArena) and frees its CPU copy, so it and the driver's copy never both exist for long. Returns false if
+    // its layout is not the arena's.
+    bool store(MeshData &meshData)
+    {
+        if (meshData.layout != layout)
+            return false;
+        const size_t vertexBytes = meshData.vertexCount * layout.stride();
+        const size_t indexStart = AlignArenaIndexOffset(indexUsed);
+        const size_t indexBytes = meshData.indexCount * meshData.indexSize;
+        if (vertexUsed + vertexBytes > vertexCapacity)
+            grow(back.VBO, vertexCapacity, vertexUsed, vertexUsed + vertexBytes, vertexMapping, vertexMapStart);
+        if (indexStart + indexBytes > indexCapacity)
+            grow(back.EBO, indexCapacity, indexUsed, indexStart + indexBytes, indexMapping, indexMapStart);
+        write(back.VBO, vertexMapping, vertexMapStart, vertexUsed, meshData.vertices, vertexBytes);
+        write(back.EBO, indexMapping, indexMapStart, indexStart, meshData.indices, indexBytes);
+
+        meshData.inArena = true;
+        meshData.arenaVertexOffset = vertexUsed;
+        meshData.arenaIndexOffset = indexStart;
+        vertexUsed += vertexBytes;
+        indexUsed = indexStart + indexBytes;
+        std::vector<unsigned char>().swap(meshData.vertexStorage);
+        std::vector<unsigned int>().swap(meshData.indexStorage);
+        std::vector<uint16_t>().swap(meshData.shortIndexStorage);
+        meshData.vertices = meshData.indices = nullptr;
+        return true;
+    }
+
+    // Fills in a mesh that was packed or stored into the back buffers (MeshData::inArena). Returns false if it is out of range.
+    bool place(const MeshData &meshData, Mesh &mesh)
+    {
+        return place(meshData, meshData.arenaVertexOffset, meshData.arenaIndexOffset, mesh);
+    }
+
+    // Unmaps the back buffers after the last mesh, sets up their VAO and makes them the front buffers. Returns false if
+    // the driver lost their contents while they were mapped (e.g. on a display mode change), in which case the model has
+    // to be uploaded again.
+    bool finish()
+    {
+        bool intact = unmap() && !contentsLost;
+        g_glState.bindVertexArray(back.VAO);
+        g_glState.bindBuffer(GL_ARRAY_BUFFER, back.VBO);
+        g_glState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, back.EBO);
+        SetVertexAttributes(layout, constantColor);
+        std::swap(front, back);
+        // The previous model's storage is orphaned; frames still in flight keep drawing from it until they complete
+        allocate(back.VBO, 0);
+        allocate(back.EBO, 0);
+        return intact;
+    }
+
+    // Drops the back buffers of a load that will not be shown
+    void abandon()
+    {
+        if (!filling)
+            return;
+        unmap();
+        allocate(back.VBO, 0);
+        allocate(back.EBO, 0);
+    }
+
+    // Replaces the instance transforms (four RGBA32F texels per matrix, one per column)
+    void uploadInstances(const std::vector<glm::mat4> &transforms)
+    {
+        if (instanceBuffer == 0)
+        {
+            glGenBuffers(1, &instanceBuffer);
+            glGenTextures(1, &instanceTexture);
+        }
+        // Always allocate at least one matrix, so the buffer texture is complete even for models without instancing
+        static const glm::mat4 identity(1.0f);
+        const void *data = transforms.empty() ? glm::value_ptr(identity) : glm::value_ptr(transforms[0]);
+        const size_t bytes = std::max<size_t>(transforms.size(), 1) * sizeof(glm::mat4);
+        g_glState.bindBuffer(GL_TEXTURE_BUFFER, instanceBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, bytes, data, GL_STATIC_DRAW);
+        g_glState.bindBuffer(GL_TEXTURE_BUFFER, 0);
+        g_glState.bindBufferTexture(kInstanceTextureUnit, instanceTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, instanceBuffer);
+    }
+
+    // Releases the GL objects (call while the context is still alive)
+    void clear()
+    {
+        if (instanceTexture != 0)
+            g_glState.deleteTexture(instanceTexture);
+        if (instanceBuffer != 0)
+            glDeleteBuffers(1, &instanceBuffer);
+        instanceBuffer = instanceTexture = 0;
+        for (GeometryBuffers *buffers : {&front, &back})
+        {
+            if (buffers->EBO != 0)
+                g_glState.deleteBuffer(buffers->EBO);
+            if (buffers->VBO != 0)
+                g_glState.deleteBuffer(buffers->VBO);
+            if (buffers->VAO != 0)
+                g_glState.deleteVertexArray(buffers->VAO);
+            *buffers = GeometryBuffers();
+        }
+        vertexCapacity = indexCapacity = vertexUsed = indexUsed = 0;
+        vertexMapping = indexMapping = nullptr;
+        vertexMapStart = indexMapStart = 0;
+        filling = contentsLost = false;
+    }
+
+private:
+    // Gives a back buffer fresh storage of 'bytes' and maps all of it for writing. The back buffers are only ever bound to
+    // GL_COPY_WRITE_BUFFER here, which leaves the VAO state and the tracked bindings of the front buffers alone.
+    static unsigned char *allocate(GLuint buffer, size_t bytes)
+    {
+        g_glState.bindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, bytes, nullptr, GL_STATIC_DRAW);
+        if (bytes == 0)
+            return nullptr;
+        // Invalidation tells the driver the old contents don't matter, so mapping never waits for or copies anything
+        return static_cast<unsigned char *>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+    }
+
+    // Moves a back buffer that is too small for 'needed' bytes to new storage with room to spare, keeping the 'used' bytes
+    // written so far, and maps the new part of it. Only grows while meshes are stored on the GL thread: a loader packing
+    // into the mapping reserved its exact size in begin().
+    void grow(GLuint &buffer, size_t &capacity, size_t used, size_t needed, unsigned char *&mapping, size_t &mapStart)
+    {
+        if (mapping)
+        {
+            g_glState.bindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+            contentsLost = glUnmapBuffer(GL_COPY_WRITE_BUFFER) != GL_TRUE || contentsLost;
+        }
+        capacity = std::max(needed, capacity + capacity / 2);
+        GLuint grown = 0;
+        glGenBuffers(1, &grown);
+        g_glState.bindBuffer(GL_COPY_WRITE_BUFFER, grown);
+        glBufferData(GL_COPY_WRITE_BUFFER, capacity, nullptr, GL_STATIC_DRAW);
+        g_glState.bindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used);
+        g_glState.deleteBuffer(buffer); // Its storage lives on until the copy has been done
+        buffer = grown;
+        // Only the unwritten part is mapped, so mapping does not wait for the copy
+        mapping = static_cast<unsigned char *>(glMapBufferRange(GL_COPY_WRITE_BUFFER, used, capacity - used,
+                                                                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT));
+        mapStart = used;
+    }
+
+    // Writes 'bytes' at 'offset' of a back buffer, through its mapping if it has one
+    static void write(GLuint buffer, unsigned char *mapping, size_t mapStart, size_t offset, const void *data, size_t bytes)
+    {
+        if (bytes == 0)
+            return;
+        if (mapping)
+        {
+            std::memcpy(mapping + (offset - mapStart), data, bytes);
+        }
+        else
+        {
+            g_glState.bindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, offset, bytes, data);
+        }
+    }
+
+    // Unmaps whatever begin mapped; false if the driver lost the contents meanwhile
+    bool unmap()
+    {
+        bool intact = true;
+        if (vertexMapping)
+        {
+            g_glState.bindBuffer(GL_COPY_WRITE_BUFFER, back.VBO);
+            intact = glUnmapBuffer(GL_COPY_WRITE_BUFFER) == GL_TRUE;
+        }
+        if (indexMapping)
+        {
+            g_glState.bindBuffer(GL_COPY_WRITE_BUFFER, back.EBO);
+            intact = glUnmapBuffer(GL_COPY_WRITE_BUFFER) == GL_TRUE && intact;
+        }
+        vertexMapping = indexMapping = nullptr;
+        filling = false;
+        return intact;
+    }
+
+    bool place(const MeshData &meshData, size_t vertexOffset, size_t indexOffset, Mesh &mesh)
+    {
+        const size_t stride = layout.stride();
+        const size_t vertexBytes = meshData.vertexCount * stride;
+        const size_t indexBytes = meshData.indexCount * meshData.indexSize;
+        if (meshData.layout != layout || vertexOffset % stride != 0 || vertexOffset + vertexBytes > vertexCapacity ||
+            indexOffset % meshData.indexSize != 0 || indexOffset + indexBytes > indexCapacity)
+            return false;
+        mesh.baseVertex = static_cast<GLint>(vertexOffset / stride);
+        mesh.indexOffset = indexOffset;
+        mesh.lods = meshData.lods;
+        mesh.indexCount = static_cast<GLsizei>(meshData.lods.empty() ? meshData.indexCount : meshData.lods[0].indexCount);
+        mesh.indexType = meshData.indexSize == sizeof(uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        mesh.format = meshData.layout.format;
+        mesh.boundsMin = meshData.boundsMin;
+        mesh.boundsMax = meshData.boundsMax;
+        mesh.sphereCenter = meshData.sphereCenter;
+        mesh.sphereRadius = meshData.sphereRadius;
+        if (meshData.layout.format == VertexFormat::Compact)
+        {
+            mesh.positionOffset = meshData.boundsMin;
+            mesh.positionScale = meshData.boundsMax - meshData.boundsMin;
+        }
+        vertexUsed = std::max(vertexUsed, vertexOffset + vertexBytes);
+        indexUsed = std::max(indexUsed, indexOffset + indexBytes);
+        return true;
+    }
+};
+
+// Global geometry arena
+GeometryArena g_geometryArena;
+
+// Runs model loads on background threads and hands finished results to the GL thread.
+// Only the most recent request is ever delivered; older in-flight loads are cancelled.
+// Loads that pack straight into the geometry arena get its back buffers mapped from poll(); only one load holds them at
+// a time, and a load holding them is never delivered or abandoned before it has ended, so it cannot outlive its mapping.
+// Streamed (low-memory) loads hold the arena too, and poll() appends the batches they push as they arrive.
+struct ModelLoader
+{
+    struct Job
+    {
+        uint64_t generation;
+        std::string path;
+        std::shared_ptr<GeometryChannel> geometry;
+        bool holdsArena = false; // The arena's back buffers were mapped for this load
+        bool streamed = false;   // It pushes its meshes batch by batch, and streamedMeshes describes the ones stored so far
+        std::vector<MeshData> streamedMeshes;
+        std::future<std::unique_ptr<ModelData>> result;
+    };
+
+    LoadSettings settings;      // Applied to every subsequent request
+    std::function<void()> wake; // Called on a loading thread when poll() has something to do (e.g. to wake the event loop)
+
+    ModelLoader() = default;
+    ModelLoader(const ModelLoader &) = delete;
+    ModelLoader &operator=(const ModelLoader &) = delete;
+
+    ~ModelLoader() { cancelAll(); }
+
+    // Starts loading 'path', cancelling any load still in flight
+    void request(const std::string &path)
+    {
+        LoadCancelToken token{&latestGeneration, latestGeneration.fetch_add(1) + 1};
+        std::string directory = std::filesystem::path(path).parent_path().string(); // Get model directory
+        LoadSettings settings = this->settings;
+        auto geometry = std::make_shared<GeometryChannel>();
+        geometry->wake = wake;
+        jobs.push_back({token.generation, path, geometry, false, false, {},
+                        std::async(std::launch::async, [path, directory, settings, token, geometry, wake = this->wake]()
+                                   {
+                                       // The peak logged after the upload starts with the load that is delivered. A load
+                                       // already cancelled when its thread starts must not restart it; cancelled loads
+                                       // still running at this point do count towards it.
+                                       if (!token.cancelled())
+                                           ResetPeakMemoryUsage();
+                                       std::unique_ptr<ModelData> data = loadModelData(path, directory, settings, geometry.get(), token);
+                                       if (wake)
+                                           wake();
+                                       return data; })});
+    }
+
+    // True while the latest request has not been delivered yet
+    bool busy() const
+    {
+        return !jobs.empty() && jobs.back().generation == latestGeneration.load();
+    }
+
+    // Maps the arena for the latest load if it asks, stores the batches a streamed load pushed into it, and returns its
+    // finished result, if any. Reaps finished stale jobs.
+    // A returned model with no meshes means the load failed. A returned model may own the arena's mapped back buffers;
+    // uploadModel finishes them.
+    std::unique_ptr<ModelData> poll()
+    {
+        std::unique_ptr<ModelData> finished;
+        const uint64_t latest = latestGeneration.load();
+        for (auto it = jobs.begin(); it != jobs.end();)
+        {
+            const bool ready = it->result.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+            GeometryChannel::Request request;
+            if (!ready && it->generation == latest && !arenaHeld() && it->geometry->takeRequest(request))
+            {
+                g_geometryArena.begin(request.layout, request.constantColor, request.vertexBytes, request.indexBytes);
+                it->geometry->reply({g_geometryArena.vertexMapping, g_geometryArena.indexMapping});
+                it->holdsArena = true;
+                it->streamed = request.streamed;
+            }
+            if (it->holdsArena)
+            {
+                // Each batch is freed right here: stored, or dropped along with a cancelled load
+                for (std::vector<MeshData> &batch : it->geometry->takeBatches())
+                {
+                    for (MeshData &meshData : batch)
+                    {
+                        if (it->generation != latest)
+                            break;
+                        g_geometryArena.store(meshData); // One that cannot be stored is reported by uploadModel
+                        it->streamedMeshes.push_back(std::move(meshData));
+                    }
+                }
+            }
+            if (!ready || (it->generation == latest && !it->holdsArena && arenaHeld()))
+            {
+                ++it; // A cancelled load is still writing into the arena; its end wakes us again
+                continue;
+            }
+            std::unique_ptr<ModelData> data = it->result.get();
+            if (it->generation == latest && data)
+            {
+                if (it->streamed)
+                    data->meshes = std::move(it->streamedMeshes);
+                if (it->holdsArena && data->meshes.empty())
+                    g_geometryArena.abandon(); // The load failed, nothing will be uploaded
+                finished = std::move(data);
+            }
             else
             {
-                vertexData.push_back(0.0f); // Default UVs
-                vertexData.push_back(0.0f);
+                if (it->holdsArena)
+                    g_geometryArena.abandon();
+                spdlog::info("Discarded cancelled load of: {}", it->path);
+            }
+            it = jobs.erase(it);
+        }
+        return finished;
+    }
+
+    // Cancels every load and waits for it to end. Loads may be writing into the arena's mapping, so this has to run
+    // before the arena is released.
+    void cancelAll()
+    {
+        latestGeneration.fetch_add(1);
+        for (auto &job : jobs)
+            job.result.wait();
+    }
+
+private:
+    bool arenaHeld() const
+    {
+        return std::any_of(jobs.begin(), jobs.end(), [](const Job &job)
+                           { return job.holdsArena; });
+    }
+
+    std::atomic<uint64_t> latestGeneration{0};
+    std::vector<Job> jobs;
+};
+
+// Meshes submitted with one glMultiDrawElementsBaseVertex call: same texture, index type and vertex decoding
+struct DrawBatch
+{
+    TextureHandle texture = 0; // 0 = untextured
+    GLuint textureId = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+    VertexFormat format = VertexFormat::Float;
+    glm::vec3 positionOffset{0.0f}, positionScale{1.0f};
+    std::vector<GLsizei> counts;
+    std::vector<const void *> offsets; // Byte offsets into the arena's index buffer
+    std::vector<GLint> baseVertices;
+    GLint instanceBase = 0;    // Instanced batches hold a single mesh drawn instanceCount times
+    GLsizei instanceCount = 0; // 0 = not instanced
+    GLuint conditionQuery = 0; // Occlusion query the (single-mesh) batch is conditionally rendered on, 0 = always drawn
+};
+
+// View frustum as six planes (inside: dot(n, p) + d >= 0), one array per component so testing a box against all
+// planes is straight-line arithmetic. Planes are left unnormalized; 'length' holds |n| for sphere tests.
+struct Frustum
+{
+    float nx[6], ny[6], nz[6], d[6];
+    float ax[6], ay[6], az[6]; // |n| per component, for projecting box extents
+    float length[6];
+
+    // Planes of a clip matrix (Gribb/Hartmann), in whatever space the matrix maps from
+    static Frustum fromMatrix(const glm::mat4 &clip)
+    {
+        Frustum f;
+        for (int p = 0; p < 6; ++p)
+        {
+            int row = p / 2;
+            float sign = (p % 2 == 0) ? 1.0f : -1.0f; // left/right, bottom/top, near/far
+            f.nx[p] = clip[0][3] + sign * clip[0][row];
+            f.ny[p] = clip[1][3] + sign * clip[1][row];
+            f.nz[p] = clip[2][3] + sign * clip[2][row];
+            f.d[p] = clip[3][3] + sign * clip[3][row];
+            f.ax[p] = std::abs(f.nx[p]);
+            f.ay[p] = std::abs(f.ny[p]);
+            f.az[p] = std::abs(f.nz[p]);
+            f.length[p] = std::sqrt(f.nx[p] * f.nx[p] + f.ny[p] * f.ny[p] + f.nz[p] * f.nz[p]);
+        }
+        return f;
+    }
+};
+
+// Bounding volume hierarchy over a model's meshes for frustum culling. Nodes are boxes split at the median
+// centroid along their longest axis. Leaf contents are stored as separate arrays (structure of arrays) in
+// leaf order, so a leaf is tested with one loop the compiler can vectorize across meshes.
+struct MeshBvh
+{
+    static constexpr uint32_t kLeafSize = 16;
+
+    struct Node
+    {
+        glm::vec3 center, extent; // Box as center and half size
+        uint32_t first;           // Leaf: first entry in 'items'; inner node: left child (the right one follows it)
+        uint32_t count;           // Meshes in a leaf, 0 for inner nodes
+    };
+
+    std::vector<Node> nodes;     // nodes[0] is the root
+    std::vector<uint32_t> items; // Mesh indices, grouped by leaf
+    // Per item: box center and half size, sphere center and radius
+    std::vector<float> boxX, boxY, boxZ, extentX, extentY, extentZ;
+    std::vector<float> sphereX, sphereY, sphereZ, radius;
+
+    void build(const std::vector<Mesh> &meshes)
+    {
+        nodes.clear();
+        items.resize(meshes.size());
+        for (size_t i = 0; i < items.size(); ++i)
+            items[i] = static_cast<uint32_t>(i);
+        if (!meshes.empty())
+        {
+            struct Task
+            {
+                uint32_t node, begin, end;
+            };
+            std::vector<Task> pending{{0, 0, static_cast<uint32_t>(meshes.size())}};
+            nodes.emplace_back();
+            while (!pending.empty())
+            {
+                Task task = pending.back();
+                pending.pop_back();
+                glm::vec3 boundsMin(std::numeric_limits<float>::max()), boundsMax(std::numeric_limits<float>::lowest());
+                glm::vec3 centroidMin = boundsMin, centroidMax = boundsMax;
+                for (uint32_t i = task.begin; i < task.end; ++i)
+                {
+                    const Mesh &mesh = meshes[items[i]];
+                    glm::vec3 centroid = (mesh.boundsMin + mesh.boundsMax) * 0.5f;
+                    boundsMin = glm::min(boundsMin, mesh.boundsMin);
+                    boundsMax = glm::max(boundsMax, mesh.boundsMax);
+                    centroidMin = glm::min(centroidMin, centroid);
+                    centroidMax = glm::max(centroidMax, centroid);
+                }
+                Node &node = nodes[task.node];
+                node.center = (boundsMin + boundsMax) * 0.5f;
+                node.extent = (boundsMax - boundsMin) * 0.5f;
+                if (task.end - task.begin <= kLeafSize)
+                {
+                    node.first = task.begin;
+                    node.count = task.end - task.begin;
+                    continue;
+                }
+
+                glm::vec3 spread = centroidMax - centroidMin;
+                int axis = spread.x >= spread.y && spread.x >= spread.z ? 0 : (spread.y >= spread.z ? 1 : 2);
+                uint32_t mid = task.begin + (task.end - task.begin) / 2;
+                std::nth_element(items.begin() + task.begin, items.begin() + mid, items.begin() + task.end, [&](uint32_t a, uint32_t b)
+                                 { return meshes[a].boundsMin[axis] + meshes[a].boundsMax[axis] < meshes[b].boundsMin[axis] + meshes[b].boundsMax[axis]; });
+                uint32_t left = static_cast<uint32_t>(nodes.size());
+                node.first = left;
+                node.count = 0;
+                nodes.emplace_back(); // Invalidates 'node'
+                nodes.emplace_back();
+                pending.push_back({left + 1, mid, task.end});
+                pending.push_back({left, task.begin, mid});
+            }
+        }
+
+        for (auto *column : {&boxX, &boxY, &boxZ, &extentX, &extentY, &extentZ, &sphereX, &sphereY, &sphereZ, &radius})
+            column->resize(items.size());
+        for (size_t i = 0; i < items.size(); ++i)
+        {
+            const Mesh &mesh = meshes[items[i]];
+            glm::vec3 center = (mesh.boundsMin + mesh.boundsMax) * 0.5f, extent = (mesh.boundsMax - mesh.boundsMin) * 0.5f;
+            boxX[i] = center.x;
+            boxY[i] = center.y;
+            boxZ[i] = center.z;
+            extentX[i] = extent.x;
+            extentY[i] = extent.y;
+            extentZ[i] = extent.z;
+            sphereX[i] = mesh.sphereCenter.x;
+            sphereY[i] = mesh.sphereCenter.y;
+            sphereZ[i] = mesh.sphereCenter.z;
+            radius[i] = mesh.sphereRadius;
+        }
+    }
+
+    // Appends the meshes whose bounds intersect the frustum. Subtrees entirely inside are accepted without
+    // further tests; in leaves a mesh is rejected when its box or its sphere lies behind any plane.
+    void cull(const Frustum &frustum, std::vector<uint32_t> &visible) const
+    {
+        if (nodes.empty())
+            return;
+        std::vector<std::pair<uint32_t, bool>> pending{{0, false}}; // Node, known to be inside
+        uint8_t outside[kLeafSize];
+        while (!pending.empty())
+        {
+            auto [index, inside] = pending.back();
+            pending.pop_back();
+            const Node &node = nodes[index];
+            if (!inside)
+            {
+                bool intersecting = false;
+                bool rejected = false;
+                for (int p = 0; p < 6; ++p)
+                {
+                    float distance = frustum.nx[p] * node.center.x + frustum.ny[p] * node.center.y + frustum.nz[p] * node.center.z + frustum.d[p];
+                    float reach = frustum.ax[p] * node.extent.x + frustum.ay[p] * node.extent.y + frustum.az[p] * node.extent.z;
+                    rejected |= distance < -reach;
+                    intersecting |= distance < reach;
+                }
+                if (rejected)
+                    continue;
+                inside = !intersecting;
+            }
+
+            if (node.count == 0)
+            {
+                pending.emplace_back(node.first + 1, inside);
+                pending.emplace_back(node.first, inside);
+                continue;
+            }
+            if (inside)
+            {
+                visible.insert(visible.end(), items.begin() + node.first, items.begin() + node.first + node.count);
+                continue;
+            }
+            // Branch-free over the leaf: every mesh against every plane, then compact the survivors
+            const uint32_t first = node.first;
+            for (uint32_t i = 0; i < node.count; ++i)
+            {
+                const uint32_t k = first + i;
+                bool out = false;
+                for (int p = 0; p < 6; ++p)
+                {
+                    float boxDistance = frustum.nx[p] * boxX[k] + frustum.ny[p] * boxY[k] + frustum.nz[p] * boxZ[k] + frustum.d[p];
+                    float boxReach = frustum.ax[p] * extentX[k] + frustum.ay[p] * extentY[k] + frustum.az[p] * extentZ[k];
+                    float sphereDistance = frustum.nx[p] * sphereX[k] + frustum.ny[p] * sphereY[k] + frustum.nz[p] * sphereZ[k] + frustum.d[p];
+                    out |= (boxDistance < -boxReach) | (sphereDistance < -radius[k] * frustum.length[p]);
+                }
+                outside[i] = out;
+            }
+            for (uint32_t i = 0; i < node.count; ++i)
+                if (!outside[i])
+                    visible.push_back(items[first + i]);
+        }
+    }
+};
+
+// A loaded model: its meshes plus one registry reference for every texture they use.
+// Destroying (or replacing) a Model releases its textures, so texture memory does not grow across model swaps.
+// Its geometry lives in g_geometryArena, so there is only ever one Model with drawable meshes.
+struct Model
+{
+    std::vector<Mesh> meshes;
+    std::vector<TextureHandle> textureRefs;
+    MeshBvh bvh;                     // Over 'meshes', for culling
+    std::vector<Occluder> occluders; // The largest meshes, for software occlusion culling
+    uint64_t version = 0;            // Unique per upload, so draw lists built for an older model are never replayed
+
+    Model() = default;
+    ~Model() { releaseTextures(); }
+
+    Model(Model &&other) noexcept
+        : meshes(std::move(other.meshes)), textureRefs(std::move(other.textureRefs)), bvh(std::move(other.bvh)),
+          occluders(std::move(other.occluders)), version(other.version)
+    {
+        other.textureRefs.clear();
+    }
+
+    Model &operator=(Model &&other) noexcept
+    {
+        if (this != &other)
+        {
+            meshes = std::move(other.meshes);
+            bvh = std::move(other.bvh);
+            occluders = std::move(other.occluders);
+            version = other.version;
+            releaseTextures(); // After the new model has acquired its references, so shared textures stay resident
+            textureRefs = std::move(other.textureRefs);
+            other.textureRefs.clear();
+        }
+        return *this;
+    }
+
+    Model(const Model &) = delete;
+    Model &operator=(const Model &) = delete;
+
+    bool empty() const { return meshes.empty(); }
+
+private:
+    void releaseTextures()
+    {
+        for (TextureHandle handle : textureRefs)
+            g_textureRegistry.release(handle);
+        textureRefs.clear();
+    }
+};
+
+// Creates the GL objects for a model produced by loadModelData (GL thread only)
+// Decoded textures are handed to the registry's uploader and stream in over the following frames.
+// Meshes already in the arena's back buffers (packed there by the loader, or streamed in by ModelLoader::poll) are just
+// placed; the others are copied into them, and each mesh's CPU copy is released right after. The back buffers then
+// become the ones drawn from.
+Model uploadModel(ModelData &data)
+{
+    Model model;
+
+    // Take one reference per texture: queue the decoded ones for upload, reuse the ones that were already resident
+    std::unordered_map<std::string, TextureHandle> handles;
+    for (auto &decoded : data.textures)
+    {
+        std::string key = decoded.key;
+        TextureHandle handle = g_textureRegistry.acquire(std::move(decoded));
+        handles.emplace(key, handle);
+        model.textureRefs.push_back(handle);
+    }
+
+    // Resolve each material's texture keys to the uploaded textures
+    std::vector<std::vector<TextureInfo>> materialTextures(data.materialTextureKeys.size());
+    for (size_t m = 0; m < data.materialTextureKeys.size(); ++m)
+    {
+        for (const auto &key : data.materialTextureKeys[m])
+        {
+            auto it = handles.find(key);
+            if (it == handles.end())
+            {
+                TextureHandle handle = g_textureRegistry.acquire(key);
+                if (handle == 0)
+                {
+                    // Was resident when the loader skipped decoding it, but has been released since
+                    spdlog::warn("Texture no longer resident, skipping: {}", key);
+                }
+                else
+                {
+                    model.textureRefs.push_back(handle);
+                }
+                it = handles.emplace(key, handle).first;
             }
+            if (it->second == 0)
+                continue;
+
+            TextureInfo texture;
+            texture.id = g_textureRegistry.glId(it->second);
+            texture.type = "texture_diffuse"; // Treat as diffuse for our simple shader
+            texture.handle = it->second;
+            materialTextures[m].push_back(texture);
         }
+    }
 
-        // Indices
-        for (unsigned int f = 0; f < mesh_ptr->mNumFaces; f++)
+    // Copy all meshes into the shared arena, unless the loader already mapped it and packed them there
+    if (!g_geometryArena.filling)
+    {
+        size_t vertexBytes = 0, indexBytes = 0;
+        for (const auto &meshData : data.meshes)
+        {
+            vertexBytes += meshData.vertexCount * meshData.layout.stride();
+            indexBytes = AlignArenaIndexOffset(indexBytes) + meshData.indexCount * meshData.indexSize;
+        }
+        g_geometryArena.begin(data.meshes.empty() ? VertexLayout() : data.meshes[0].layout, data.constantColor, vertexBytes, indexBytes);
+    }
+    g_geometryArena.uploadInstances(data.instanceTransforms);
+
+    model.occluders = std::move(data.occluders);
+    model.meshes.reserve(data.meshes.size());
+    for (auto &meshData : data.meshes)
+    {
+        if (meshData.indexCount == 0 || meshData.vertexCount == 0)
+            continue; // Nothing to draw
+        Mesh mesh;
+        if (!(meshData.inArena || g_geometryArena.store(meshData)) || !g_geometryArena.place(meshData, mesh))
+        {
+            spdlog::error("Mesh does not fit the geometry arena, skipping");
+            continue;
+        }
+        if (meshData.instanceCount > 1)
+        {
+            // Bounds of all instances in model space, from the transformed corners of the local box
+            mesh.instanceBase = static_cast<GLint>(meshData.firstInstance);
+            mesh.instanceCount = static_cast<GLsizei>(meshData.instanceCount);
+            glm::vec3 worldMin(std::numeric_limits<float>::max()), worldMax(std::numeric_limits<float>::lowest());
+            for (uint32_t n = 0; n < meshData.instanceCount; ++n)
+            {
+                const glm::mat4 &transform = data.instanceTransforms[meshData.firstInstance + n];
+                for (int corner = 0; corner < 8; ++corner)
+                {
+                    glm::vec3 local((corner & 1) ? meshData.boundsMax.x : meshData.boundsMin.x,
+                                    (corner & 2) ? meshData.boundsMax.y : meshData.boundsMin.y,
+                                    (corner & 4) ? meshData.boundsMax.z : meshData.boundsMin.z);
+                    glm::vec3 world(transform * glm::vec4(local, 1.0f));
+                    worldMin = glm::min(worldMin, world);
+                    worldMax = glm::max(worldMax, world);
+                }
+            }
+            mesh.boundsMin = worldMin;
+            mesh.boundsMax = worldMax;
+            // A sphere around the box center reaching every instance's (scaled) sphere
+            mesh.sphereCenter = (worldMin + worldMax) * 0.5f;
+            mesh.sphereRadius = 0.0f;
+            for (uint32_t n = 0; n < meshData.instanceCount; ++n)
+            {
+                const glm::mat4 &transform = data.instanceTransforms[meshData.firstInstance + n];
+                float scale = std::max({glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])),
+                                        glm::length(glm::vec3(transform[2]))});
+                glm::vec3 center(transform * glm::vec4(meshData.sphereCenter, 1.0f));
+                mesh.sphereRadius = std::max(mesh.sphereRadius, glm::length(center - mesh.sphereCenter) + meshData.sphereRadius * scale);
+            }
+        }
+        if (meshData.materialIndex < materialTextures.size())
+            mesh.textures = materialTextures[meshData.materialIndex]; // Textures for the current mesh
+        for (const auto &texInfo : mesh.textures)
+        {
+            if (texInfo.type == "texture_diffuse" && texInfo.id != 0)
+            {
+                mesh.texture = texInfo.handle;
+                mesh.textureId = texInfo.id;
+                break; // Simplified: use only the first diffuse texture found
+            }
+        }
+        model.meshes.push_back(std::move(mesh));
+    }
+    if (!g_geometryArena.finish())
+    {
+        spdlog::error("Geometry buffers were lost during upload, drop the model again to reload it");
+        model.meshes.clear();
+        model.occluders.clear();
+    }
+
+    model.bvh.build(model.meshes);
+
+    static uint64_t uploads = 0;
+    model.version = ++uploads;
+    spdlog::info("Uploaded {} meshes", model.meshes.size());
+    return model;
+}
+
+// Draws a list of batches from the arena's VAO
+void submitBatches(const std::vector<DrawBatch> &batches, const Shader &shaderProgram, const MeshUniforms &uniforms)
+{
+    if (batches.empty())
+        return;
+
+    shaderProgram.use(); // Ensure shader is active
+    g_glState.bindVertexArray(g_geometryArena.front.VAO);
+    for (const DrawBatch &batch : batches)
+    {
+        bool hasDiffuseTexture = batch.textureId != 0 && TextureReady(batch.texture); // Skip textures still streaming in
+        if (hasDiffuseTexture)
+            g_glState.bindTexture(0, batch.textureId); // The uDiffuseSampler uniform is set once at startup
+        glUniform1i(uniforms.hasDiffuseTexture, hasDiffuseTexture ? 1 : 0);
+        // Per-batch vertex decoding (identity for the float layout)
+        glUniform3fv(uniforms.positionOffset, 1, glm::value_ptr(batch.positionOffset));
+        glUniform3fv(uniforms.positionScale, 1, glm::value_ptr(batch.positionScale));
+        glUniform1i(uniforms.octahedralNormals, batch.format == VertexFormat::Compact ? 1 : 0);
+        glUniform1i(uniforms.instanced, batch.instanceCount > 0 ? 1 : 0);
+
+        if (batch.conditionQuery != 0)
+            glBeginConditionalRender(batch.conditionQuery, GL_QUERY_WAIT); // Waits on the GPU, never on the CPU
+        if (batch.instanceCount > 0)
+        {
+            // The uInstanceMatrices uniform is set once at startup
+            g_glState.bindBufferTexture(kInstanceTextureUnit, g_geometryArena.instanceTexture);
+            glUniform1i(uniforms.instanceBase, batch.instanceBase);
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, batch.counts[0], batch.indexType, batch.offsets[0],
+                                              batch.instanceCount, batch.baseVertices[0]);
+        }
+        else
+        {
+            glMultiDrawElementsBaseVertex(GL_TRIANGLES, batch.counts.data(), batch.indexType, batch.offsets.data(),
+                                          static_cast<GLsizei>(batch.counts.size()), batch.baseVertices.data());
+        }
+        if (batch.conditionQuery != 0)
+            glEndConditionalRender();
+    }
+}
+
+// Occlusion culling with hardware queries (GL_ANY_SAMPLES_PASSED) and temporal coherence. Each frame:
+//   1. results of earlier queries that are already available are collected (never waited for)
+//   2. meshes visible by the last result are drawn normally, filling the depth buffer
+//   3. every mesh in the frustum without a query in flight gets one, drawing its bounding box with writes disabled
+//   4. meshes occluded by the last result are drawn under conditional rendering on their newest query,
+//      so one that comes into view appears in the same frame instead of popping in later.
+// A mesh's own surface never hides its box (the box encloses it), so the proxies can be tested after step 2.
+struct OcclusionCuller
+{
+    static constexpr float kBoxInflation = 1.01f; // Keeps box faces in front of flat meshes lying on them
+
+    std::vector<GLuint> queries;   // Per mesh, 0 = never queried
+    std::vector<uint8_t> occluded; // Per mesh, by the newest available result
+    uint64_t version = 0;          // Bumped whenever 'occluded' changes
+    size_t issued = 0;             // Queries issued since the last takeIssued (for --gl-stats)
+
+    bool init()
+    {
+        shader = std::make_unique<Shader>("shaders/occlusion_vs.glsl", "shaders/occlusion_fs.glsl");
+        if (shader->id == 0)
+            return false;
+        shader->bindUniformBlock("FrameData", kFrameUniformBinding);
+        boxCenter = shader->uniformLocation("uBoxCenter");
+        boxExtent = shader->uniformLocation("uBoxExtent");
+
+        static const float corners[] = {-1, -1, -1, 1, -1, -1, -1, 1, -1, 1, 1, -1, -1, -1, 1, 1, -1, 1, -1, 1, 1, 1, 1, 1};
+        static const uint8_t faces[] = {0, 1, 3, 0, 3, 2, 4, 6, 7, 4, 7, 5, 0, 4, 5, 0, 5, 1,
+                                        2, 3, 7, 2, 7, 6, 0, 2, 6, 0, 6, 4, 1, 5, 7, 1, 7, 3};
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
+        g_glState.bindVertexArray(VAO);
+        g_glState.bindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+        g_glState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(faces), faces, GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
+        return true;
+    }
+
+    // Step 1: picks up finished queries. Starts over when the model changed.
+    void collectResults(const Model &model)
+    {
+        if (model.version != modelVersion)
+        {
+            releaseQueries();
+            modelVersion = model.version;
+            queries.assign(model.meshes.size(), 0);
+            occluded.assign(model.meshes.size(), 0);
+            inFlight.assign(model.meshes.size(), 0);
+            version++;
+            return;
+        }
+        size_t kept = 0;
+        for (uint32_t mesh : pending)
+        {
+            GLuint available = 0;
+            glGetQueryObjectuiv(queries[mesh], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+            {
+                pending[kept++] = mesh;
+                continue;
+            }
+            GLuint anySamples = 0;
+            glGetQueryObjectuiv(queries[mesh], GL_QUERY_RESULT, &anySamples);
+            uint8_t hidden = anySamples ? 0 : 1;
+            if (occluded[mesh] != hidden)
+            {
+                occluded[mesh] = hidden;
+                version++;
+            }
+        }
+        pending.resize(kept);
+        inFlight.assign(queries.size(), 0);
+        for (uint32_t mesh : pending)
+            inFlight[mesh] = 1;
+    }
+
+    // Step 3: queries the boxes of the meshes that passed frustum culling
+    void issueQueries(const Model &model, const std::vector<uint32_t> &candidates, const glm::mat4 &modelView)
+    {
+        const glm::vec3 eye(glm::inverse(modelView)[3]); // Camera position in model space
+        bool started = false;
+        for (uint32_t i : candidates)
+        {
+            if (inFlight[i])
+                continue;
+            const Mesh &mesh = model.meshes[i];
+            glm::vec3 center = (mesh.boundsMin + mesh.boundsMax) * 0.5f;
+            glm::vec3 extent = (mesh.boundsMax - mesh.boundsMin) * (0.5f * kBoxInflation) + glm::vec3(1e-4f);
+            if (glm::all(glm::lessThanEqual(glm::abs(eye - center), extent)))
+            {
+                // The near plane clips a box around the camera, so its query would report nothing: assume visible
+                if (occluded[i])
+                {
+                    occluded[i] = 0;
+                    version++;
+                }
+                continue;
+            }
+            if (!started)
+            {
+                shader->use();
+                g_glState.bindVertexArray(VAO);
+                glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+                glDepthMask(GL_FALSE);
+                started = true;
+            }
+            if (queries[i] == 0)
+                glGenQueries(1, &queries[i]);
+            glUniform3fv(boxCenter, 1, glm::value_ptr(center));
+            glUniform3fv(boxExtent, 1, glm::value_ptr(extent));
+            glBeginQuery(GL_ANY_SAMPLES_PASSED, queries[i]);
+            glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_BYTE, nullptr);
+            glEndQuery(GL_ANY_SAMPLES_PASSED);
+            pending.push_back(i);
+            inFlight[i] = 1;
+            issued++;
+        }
+        if (started)
+        {
+            glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+            glDepthMask(GL_TRUE);
+        }
+    }
+
+    // Releases the GL objects (call while the context is still alive)
+    void clear()
+    {
+        releaseQueries();
+        if (EBO != 0)
+            g_glState.deleteBuffer(EBO);
+        if (VBO != 0)
+            g_glState.deleteBuffer(VBO);
+        if (VAO != 0)
+            g_glState.deleteVertexArray(VAO);
+        VAO = VBO = EBO = 0;
+        shader.reset();
+    }
+
+private:
+    void releaseQueries()
+    {
+        for (GLuint query : queries)
+            if (query != 0)
+                glDeleteQueries(1, &query);
+        queries.clear();
+        occluded.clear();
+        pending.clear();
+        inFlight.clear();
+    }
+
+    std::unique_ptr<Shader> shader; // Box proxies
+    GLint boxCenter = -1, boxExtent = -1;
+    GLuint VAO = 0, VBO = 0, EBO = 0; // Unit cube
+    std::vector<uint32_t> pending;    // Meshes with a query in flight, oldest first
+    std::vector<uint8_t> inFlight;    // Per mesh, whether it is in 'pending'
+    uint64_t modelVersion = 0;
+};
+
+// CPU occlusion culling against a low-resolution depth buffer of the model's largest meshes.
+// The occluders are transformed and binned into screen tiles, the tiles are rasterized in parallel (8 or 4 pixels
+// at a time with AVX2/SSE2, scalar elsewhere), and every tile reduces its depths to a max-depth hierarchical
+// level of 8x8 pixel blocks. A mesh is hidden when the nearest point of its bounding box lies behind the
+// farthest occluder depth of every block its screen rectangle touches. Works the same on llvmpipe as on a GPU.
+struct SoftwareOcclusion
+{
+    static constexpr int kWidth = 256, kHeight = 128;       // Depth buffer resolution
+    static constexpr int kTileWidth = 64, kTileHeight = 32; // Unit of parallel work (multiples of the SIMD width)
+    static constexpr int kBlockSize = 8;                    // Pixels per side of a hierarchical depth block
+    static constexpr int kBlocksX = kWidth / kBlockSize, kBlocksY = kHeight / kBlockSize;
+    static constexpr float kNearW = 1e-3f; // Clip w below which geometry counts as crossing the eye plane
+
+    std::vector<float> depth = std::vector<float>(kWidth * kHeight, 1.0f); // Window-space depth, rows bottom-up
+    std::vector<float> maxDepth = std::vector<float>(kBlocksX * kBlocksY, 1.0f);
+    size_t trianglesDrawn = 0; // Occluder triangles rasterized by the last render
+
+    // Rasterizes the model's occluders as seen through 'clip' (model space to clip space)
+    void render(const Model &model, const glm::mat4 &clip)
+    {
+        // --- Transform and set up every occluder triangle ---
+        triangles.clear();
+        for (const Occluder &occluder : model.occluders)
+        {
+            screen.resize(occluder.positions.size());
+            for (size_t v = 0; v < occluder.positions.size(); ++v)
+            {
+                glm::vec4 p = clip * glm::vec4(occluder.positions[v], 1.0f);
+                if (p.w < kNearW)
+                {
+                    screen[v] = glm::vec4(0.0f, 0.0f, 0.0f, -1.0f); // Marks the vertex as unusable
+                    continue;
+                }
+                float invW = 1.0f / p.w;
+                screen[v] = glm::vec4((p.x * invW * 0.5f + 0.5f) * kWidth, (p.y * invW * 0.5f + 0.5f) * kHeight,
+                                      p.z * invW * 0.5f + 0.5f, 1.0f);
+            }
+            for (size_t t = 0; t + 2 < occluder.indices.size(); t += 3)
+            {
+                const glm::vec4 &a = screen[occluder.indices[t]], &b = screen[occluder.indices[t + 1]], &c = screen[occluder.indices[t + 2]];
+                if (a.w < 0.0f || b.w < 0.0f || c.w < 0.0f)
+                    continue; // Crosses the eye plane; dropping an occluder only makes culling more conservative
+                addTriangle(a, b, c);
+            }
+        }
+        trianglesDrawn = triangles.size();
+
+        // --- Bin by tile, then rasterize the tiles in parallel ---
+        constexpr int tilesX = kWidth / kTileWidth, tilesY = kHeight / kTileHeight;
+        bins.resize(tilesX * tilesY);
+        for (auto &bin : bins)
+            bin.clear();
+        for (uint32_t t = 0; t < triangles.size(); ++t)
+        {
+            const ScreenTriangle &tri = triangles[t];
+            for (int ty = tri.minY / kTileHeight; ty <= tri.maxY / kTileHeight; ++ty)
+                for (int tx = tri.minX / kTileWidth; tx <= tri.maxX / kTileWidth; ++tx)
+                    bins[ty * tilesX + tx].push_back(t);
+        }
+        GetWorkerPool().parallelFor(bins.size(), [&](size_t tile)
+                                    { rasterizeTile(static_cast<int>(tile % tilesX) * kTileWidth, static_cast<int>(tile / tilesX) * kTileHeight, bins[tile]); });
+    }
+
+    // Whether anything of the box may be visible. Conservative: boxes reaching behind the eye are always visible.
+    bool visible(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, const glm::mat4 &clip) const
+    {
+        float minX = std::numeric_limits<float>::max(), minY = minX, minZ = minX;
+        float maxX = std::numeric_limits<float>::lowest(), maxY = maxX;
+        for (int corner = 0; corner < 8; ++corner)
+        {
+            glm::vec4 p = clip * glm::vec4((corner & 1) ? boundsMax.x : boundsMin.x, (corner & 2) ? boundsMax.y : boundsMin.y,
+                                           (corner & 4) ? boundsMax.z : boundsMin.z, 1.0f);
+            if (p.w < kNearW)
+                return true;
+            float invW = 1.0f / p.w;
+            float x = (p.x * invW * 0.5f + 0.5f) * kWidth, y = (p.y * invW * 0.5f + 0.5f) * kHeight;
+            minX = std::min(minX, x);
+            maxX = std::max(maxX, x);
+            minY = std::min(minY, y);
+            maxY = std::max(maxY, y);
+            minZ = std::min(minZ, p.z * invW * 0.5f + 0.5f);
+        }
+        int x0 = std::max(static_cast<int>(std::floor(minX)), 0) / kBlockSize;
+        int x1 = std::min(static_cast<int>(std::floor(maxX)), kWidth - 1) / kBlockSize;
+        int y0 = std::max(static_cast<int>(std::floor(minY)), 0) / kBlockSize;
+        int y1 = std::min(static_cast<int>(std::floor(maxY)), kHeight - 1) / kBlockSize;
+        if (x0 > x1 || y0 > y1)
+            return true; // Off screen; the frustum test decides
+        for (int by = y0; by <= y1; ++by)
+            for (int bx = x0; bx <= x1; ++bx)
+                if (minZ <= maxDepth[by * kBlocksX + bx])
+                    return true;
+        return false;
+    }
+
+private:
+    struct ScreenTriangle
+    {
+        float e[3], ex[3], ey[3];   // Edge functions at the origin and their steps per pixel in x and y (inside: all >= 0)
+        float z, zx, zy;            // Depth plane: depth at the origin and its steps
+        int minX, minY, maxX, maxY; // Pixel bounds, clamped to the buffer
+    };
+
+    void addTriangle(glm::vec4 a, glm::vec4 b, glm::vec4 c)
+    {
+        float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+        if (area == 0.0f)
+            return;
+        if (area < 0.0f)
+        {
+            std::swap(b, c); // Both windings occlude
+            area = -area;
+        }
+        ScreenTriangle tri;
+        tri.minX = std::max(static_cast<int>(std::floor(std::min({a.x, b.x, c.x}))), 0);
+        tri.maxX = std::min(static_cast<int>(std::ceil(std::max({a.x, b.x, c.x}))), kWidth - 1);
+        tri.minY = std::max(static_cast<int>(std::floor(std::min({a.y, b.y, c.y}))), 0);
+        tri.maxY = std::min(static_cast<int>(std::ceil(std::max({a.y, b.y, c.y}))), kHeight - 1);
+        if (tri.minX > tri.maxX || tri.minY > tri.maxY)
+            return;
+        // Edge from p to q: (q.x - p.x) * (y - p.y) - (q.y - p.y) * (x - p.x), positive on the side of the third vertex
+        const glm::vec4 *from[3] = {&a, &b, &c}, *to[3] = {&b, &c, &a};
+        for (int i = 0; i < 3; ++i)
+        {
+            tri.ex[i] = -(to[i]->y - from[i]->y);
+            tri.ey[i] = to[i]->x - from[i]->x;
+            tri.e[i] = -(tri.ex[i] * from[i]->x + tri.ey[i] * from[i]->y);
+        }
+        tri.zx = ((b.z - a.z) * (c.y - a.y) - (c.z - a.z) * (b.y - a.y)) / area;
+        tri.zy = ((c.z - a.z) * (b.x - a.x) - (b.z - a.z) * (c.x - a.x)) / area;
+        tri.z = a.z - tri.zx * a.x - tri.zy * a.y;
+        triangles.push_back(tri);
+    }
+
+    void rasterizeTile(int tileX, int tileY, const std::vector<uint32_t> &bin)
+    {
+        for (int y = tileY; y < tileY + kTileHeight; ++y)
+            std::fill_n(&depth[y * kWidth + tileX], kTileWidth, 1.0f);
+
+        for (uint32_t t : bin)
         {
-            aiFace face = mesh_ptr->mFaces[f];
-            for (unsigned int j = 0; j < face.mNumIndices; j++)
-                indices.push_back(face.mIndices[j]);
+            const ScreenTriangle &tri = triangles[t];
+            // Whole SIMD groups, aligned within the tile (tile sizes are multiples of the group width)
+            const int x0 = std::max(tri.minX, tileX) & ~7;
+            const int x1 = std::min(tri.maxX + 1, tileX + kTileWidth);
+            const int y0 = std::max(tri.minY, tileY), y1 = std::min(tri.maxY + 1, tileY + kTileHeight);
+            for (int y = y0; y < y1; ++y)
+            {
+                float px = x0 + 0.5f, py = y + 0.5f; // Pixel centers
+                float e0 = tri.e[0] + tri.ex[0] * px + tri.ey[0] * py;
+                float e1 = tri.e[1] + tri.ex[1] * px + tri.ey[1] * py;
+                float e2 = tri.e[2] + tri.ex[2] * px + tri.ey[2] * py;
+                float z = tri.z + tri.zx * px + tri.zy * py;
+                rasterizeSpan(&depth[y * kWidth], x0, x1, e0, e1, e2, z, tri);
+            }
+        }
+
+        // Farthest depth per block of the tile
+        for (int by = tileY / kBlockSize; by < (tileY + kTileHeight) / kBlockSize; ++by)
+        {
+            for (int bx = tileX / kBlockSize; bx < (tileX + kTileWidth) / kBlockSize; ++bx)
+            {
+                float farthest = 0.0f;
+                for (int y = by * kBlockSize; y < (by + 1) * kBlockSize; ++y)
+                    for (int x = bx * kBlockSize; x < (bx + 1) * kBlockSize; ++x)
+                        farthest = std::max(farthest, depth[y * kWidth + x]);
+                maxDepth[by * kBlocksX + bx] = farthest;
+            }
         }
+    }
 
-        // Process materials and textures (simplified: only loads diffuse textures)
-        if (mesh_ptr->mMaterialIndex >= 0)
+    // Depth-tests and writes pixels [x0, x1) of one row (x0 is a multiple of 8); e0..e2 and z are the values at x0
+    static void rasterizeSpan(float *row, int x0, int x1, float e0, float e1, float e2, float z, const ScreenTriangle &tri)
+    {
+#if defined(SMV_SIMD_AVX2)
+        const __m256 lane = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7), zero = _mm256_setzero_ps();
+        __m256 E0 = _mm256_add_ps(_mm256_set1_ps(e0), _mm256_mul_ps(_mm256_set1_ps(tri.ex[0]), lane));
+        __m256 E1 = _mm256_add_ps(_mm256_set1_ps(e1), _mm256_mul_ps(_mm256_set1_ps(tri.ex[1]), lane));
+        __m256 E2 = _mm256_add_ps(_mm256_set1_ps(e2), _mm256_mul_ps(_mm256_set1_ps(tri.ex[2]), lane));
+        __m256 Z = _mm256_add_ps(_mm256_set1_ps(z), _mm256_mul_ps(_mm256_set1_ps(tri.zx), lane));
+        const __m256 stepE0 = _mm256_set1_ps(tri.ex[0] * 8), stepE1 = _mm256_set1_ps(tri.ex[1] * 8);
+        const __m256 stepE2 = _mm256_set1_ps(tri.ex[2] * 8), stepZ = _mm256_set1_ps(tri.zx * 8);
+        for (int x = x0; x < x1; x += 8)
+        {
+            __m256 inside = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(E0, zero, _CMP_GE_OQ), _mm256_cmp_ps(E1, zero, _CMP_GE_OQ)),
+                                          _mm256_cmp_ps(E2, zero, _CMP_GE_OQ));
+            __m256 previous = _mm256_loadu_ps(row + x);
+            _mm256_storeu_ps(row + x, _mm256_blendv_ps(previous, _mm256_min_ps(previous, Z), inside));
+            E0 = _mm256_add_ps(E0, stepE0);
+            E1 = _mm256_add_ps(E1, stepE1);
+            E2 = _mm256_add_ps(E2, stepE2);
+            Z = _mm256_add_ps(Z, stepZ);
+        }
+#elif defined(SMV_SIMD_SSE2)
+        const __m128 lane = _mm_setr_ps(0, 1, 2, 3), zero = _mm_setzero_ps();
+        __m128 E0 = _mm_add_ps(_mm_set1_ps(e0), _mm_mul_ps(_mm_set1_ps(tri.ex[0]), lane));
+        __m128 E1 = _mm_add_ps(_mm_set1_ps(e1), _mm_mul_ps(_mm_set1_ps(tri.ex[1]), lane));
+        __m128 E2 = _mm_add_ps(_mm_set1_ps(e2), _mm_mul_ps(_mm_set1_ps(tri.ex[2]), lane));
+        __m128 Z = _mm_add_ps(_mm_set1_ps(z), _mm_mul_ps(_mm_set1_ps(tri.zx), lane));
+        const __m128 stepE0 = _mm_set1_ps(tri.ex[0] * 4), stepE1 = _mm_set1_ps(tri.ex[1] * 4);
+        const __m128 stepE2 = _mm_set1_ps(tri.ex[2] * 4), stepZ = _mm_set1_ps(tri.zx * 4);
+        for (int x = x0; x < x1; x += 4)
+        {
+            __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(E0, zero), _mm_cmpge_ps(E1, zero)), _mm_cmpge_ps(E2, zero));
+            __m128 previous = _mm_loadu_ps(row + x);
+            __m128 nearer = _mm_min_ps(previous, Z);
+            _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, previous)));
+            E0 = _mm_add_ps(E0, stepE0);
+            E1 = _mm_add_ps(E1, stepE1);
+            E2 = _mm_add_ps(E2, stepE2);
+            Z = _mm_add_ps(Z, stepZ);
+        }
+#else
+        for (int x = x0; x < x1; ++x)
         {
-            aiMaterial *material = scene->mMaterials[mesh_ptr->mMaterialIndex];
-            // Pass the Assimp scene pointer and the original model path for embedded texture handling
-            meshTextures = loadMaterialTextures(material, directory, scene, path);
+            if (e0 >= 0.0f && e1 >= 0.0f && e2 >= 0.0f)
+                row[x] = std::min(row[x], z);
+            e0 += tri.ex[0];
+            e1 += tri.ex[1];
+            e2 += tri.ex[2];
+            z += tri.zx;
         }
+#endif
+    }
+
+    std::vector<ScreenTriangle> triangles;
+    std::vector<std::vector<uint32_t>> bins; // Triangles overlapping each tile
+    std::vector<glm::vec4> screen;           // Window-space vertices of the occluder being set up
+};
 
-        meshes_vec.emplace_back(vertexData, indices, meshTextures); // Pass texture info to Mesh constructor
+// LSD radix sort of 64-bit keys together with their payload, one byte per pass.
+// Passes where every key has the same byte are skipped, which is most of them for a narrow range of keys.
+void RadixSortKeys(std::vector<uint64_t> &keys, std::vector<uint32_t> &values,
+                   std::vector<uint64_t> &keyScratch, std::vector<uint32_t> &valueScratch)
+{
+    const size_t n = keys.size();
+    if (n < 2)
+        return;
+    std::vector<size_t> histograms(8 * 256, 0);
+    for (uint64_t key : keys)
+        for (int pass = 0; pass < 8; ++pass)
+            histograms[pass * 256 + ((key >> (pass * 8)) & 0xFF)]++;
+
+    keyScratch.resize(n);
+    valueScratch.resize(n);
+    for (int pass = 0; pass < 8; ++pass)
+    {
+        size_t *counts = &histograms[pass * 256];
+        const int shift = pass * 8;
+        if (counts[(keys[0] >> shift) & 0xFF] == n)
+            continue; // Every key has this byte
+        size_t offset = 0;
+        for (int b = 0; b < 256; ++b)
+        {
+            size_t count = counts[b];
+            counts[b] = offset;
+            offset += count;
+        }
+        for (size_t i = 0; i < n; ++i)
+        {
+            size_t dst = counts[(keys[i] >> shift) & 0xFF]++;
+            keyScratch[dst] = keys[i];
+            valueScratch[dst] = values[i];
+        }
+        keys.swap(keyScratch);
+        values.swap(valueScratch);
     }
-    return meshes_vec;
 }
 
+// Orders a model's meshes for submission. Every mesh gets a 64-bit sort key
+//   program (4 bits) | texture (20 bits) | index type (1 bit) | view depth (24 bits) | unused (15 bits)
+// so draws are grouped by texture and drawn front-to-back within a texture for early-Z. The sorted meshes are
+// merged into multi-draw batches. Meshes outside the view frustum are culled first (through the model's BVH).
+// Software occlusion culling then drops meshes hidden behind the model's occluders. Each remaining mesh is drawn at
+// the coarsest detail level whose error projects to at most lodErrorPixels on screen. With hardware occlusion
+// culling, meshes hidden by their last query go to a separate list of conditional single-mesh batches.
+// While neither the model, the camera nor the occlusion results change, the last lists are replayed.
+struct RenderQueue
+{
+    static constexpr float kMaxDepth = 100.0f; // Matches the far plane
+
+    // Sorted batches of the visible meshes of 'model' seen through 'modelView' and 'proj'
+    const std::vector<DrawBatch> &build(const Model &model, const glm::mat4 &modelView, const glm::mat4 &proj, int viewportHeight,
+                                        const OcclusionCuller *occlusion = nullptr, SoftwareOcclusion *software = nullptr)
+    {
+        const uint64_t currentOcclusion = occlusion ? occlusion->version : 0;
+        if (valid && model.version == modelVersion && modelView == lastModelView && proj == lastProj &&
+            viewportHeight == lastViewportHeight && currentOcclusion == occlusionVersion)
+        {
+            replays++;
+            return batches;
+        }
+        valid = true;
+        modelVersion = model.version;
+        lastModelView = modelView;
+        lastProj = proj;
+        lastViewportHeight = viewportHeight;
+        occlusionVersion = currentOcclusion;
+        rebuilds++;
+
+        auto cullStart = std::chrono::steady_clock::now();
+        visible.clear();
+        const glm::mat4 clip = proj * modelView;
+        model.bvh.cull(Frustum::fromMatrix(clip), visible); // Planes in model space, where the bounds are
+        softwareOccluded = 0;
+        if (software && !model.occluders.empty())
+        {
+            software->render(model, clip);
+            size_t kept = 0;
+            for (uint32_t i : visible)
+                if (software->visible(model.meshes[i].boundsMin, model.meshes[i].boundsMax, clip))
+                    visible[kept++] = i;
+            softwareOccluded = visible.size() - kept;
+            visible.resize(kept);
+        }
+        cullSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - cullStart).count();
+        visibleMeshes = visible.size();
+        totalMeshes = model.meshes.size();
+
+        keys.clear();
+        items.clear();
+        for (uint32_t i : visible)
+        {
+            const Mesh &mesh = model.meshes[i];
+            glm::vec3 center = (mesh.boundsMin + mesh.boundsMax) * 0.5f;
+            // View-space distance along the view direction: -z of modelView * center
+            float depth = -(modelView[0][2] * center.x + modelView[1][2] * center.y + modelView[2][2] * center.z + modelView[3][2]);
+            uint64_t depthBits = static_cast<uint64_t>(glm::clamp(depth / kMaxDepth, 0.0f, 1.0f) * float((1 << 24) - 1));
+            uint64_t key = (uint64_t(0) << 60) | // Single program for now
+                           (uint64_t(mesh.texture & 0xFFFFF) << 40) |
+                           (uint64_t(mesh.indexType == GL_UNSIGNED_SHORT ? 0 : 1) << 39) |
+                           (depthBits << 15);
+            keys.push_back(key);
+            items.push_back(i);
+        }
+        RadixSortKeys(keys, items, keyScratch, itemScratch);
+
+        // Merge runs of meshes that share all batch state. Compact meshes carry their own dequantization and
+        // instanced meshes their own instance range, so they never share a batch (GL 3.3 has no per-draw index
+        // to fetch either in the shader).
+        batches.clear();
+        conditionalBatches.clear();
+        occludedMeshes = 0;
+        trianglesFull = trianglesDrawn = 0;
+        // Model units to pixels at distance 1 (the model matrix has no scale)
+        const float pixelsPerUnit = proj[1][1] * 0.5f * static_cast<float>(viewportHeight);
+        const glm::vec3 eye(glm::inverse(modelView)[3]);
+        const Mesh *previous = nullptr;
+        for (uint32_t item : items)
+        {
+            const Mesh &mesh = model.meshes[item];
+            MeshLod lod = selectLod(mesh, eye, pixelsPerUnit);
+            const size_t indexSize = mesh.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+            const size_t indexOffset = mesh.indexOffset + lod.firstIndex * indexSize;
+            const GLsizei indexCount = static_cast<GLsizei>(lod.indexCount);
+            trianglesFull += mesh.indexCount / 3;
+            trianglesDrawn += lod.indexCount / 3;
+            if (occlusion && item < occlusion->occluded.size() && occlusion->occluded[item])
+            {
+                conditionalBatches.push_back(singleMeshBatch(mesh, indexOffset, indexCount));
+                conditionalBatches.back().conditionQuery = occlusion->queries[item];
+                occludedMeshes++;
+                continue;
+            }
+            bool sameState = previous && previous->texture == mesh.texture && previous->indexType == mesh.indexType &&
+                             mesh.format == VertexFormat::Float && previous->format == VertexFormat::Float &&
+                             mesh.instanceCount == 0 && previous->instanceCount == 0;
+            if (!sameState)
+            {
+                batches.push_back(singleMeshBatch(mesh, indexOffset, indexCount));
+            }
+            else
+            {
+                DrawBatch &batch = batches.back();
+                batch.counts.push_back(indexCount);
+                batch.offsets.push_back(reinterpret_cast<const void *>(indexOffset));
+                batch.baseVertices.push_back(mesh.baseVertex);
+            }
+            previous = &mesh;
+        }
+        return batches;
+    }
+
+    // Meshes that passed frustum culling in the last build, in no particular order
+    const std::vector<uint32_t> &visibleItems() const { return visible; }
+    // Meshes hidden by their last occlusion query, each conditionally rendered on its newest query
+    const std::vector<DrawBatch> &occludedBatches() const { return conditionalBatches; }
+
+    size_t rebuilds = 0, replays = 0;             // Frames that rebuilt / reused the list (for --gl-stats)
+    double cullSeconds = 0.0;                     // Time spent culling in those rebuilds
+    size_t visibleMeshes = 0, totalMeshes = 0;    // Of the current list
+    size_t occludedMeshes = 0;                    // Of the visible ones, drawn conditionally
+    size_t softwareOccluded = 0;                  // Culled by software occlusion (not counted as visible)
+    size_t trianglesFull = 0, trianglesDrawn = 0; // Of the visible meshes at full detail / at their selected level
+    float lodErrorPixels = 1.0f;                  // Largest on-screen error a detail level may have
+
+private:
+    // Coarsest level whose error, projected at the nearest point of the mesh's bounding sphere, stays within budget
+    MeshLod selectLod(const Mesh &mesh, const glm::vec3 &eye, float pixelsPerUnit) const
+    {
+        if (mesh.lods.empty())
+            return {0, static_cast<size_t>(mesh.indexCount), 0.0f};
+        float distance = std::max(glm::length(mesh.sphereCenter - eye) - mesh.sphereRadius, 0.1f); // Near plane
+        size_t level = 0;
+        while (level + 1 < mesh.lods.size() && mesh.lods[level + 1].error * pixelsPerUnit / distance <= lodErrorPixels)
+            level++;
+        return mesh.lods[level];
+    }
+
+    static DrawBatch singleMeshBatch(const Mesh &mesh, size_t indexOffset, GLsizei indexCount)
+    {
+        DrawBatch batch;
+        batch.texture = mesh.texture;
+        batch.textureId = mesh.textureId;
+        batch.indexType = mesh.indexType;
+        batch.format = mesh.format;
+        batch.positionOffset = mesh.positionOffset;
+        batch.positionScale = mesh.positionScale;
+        batch.instanceBase = mesh.instanceBase;
+        batch.instanceCount = mesh.instanceCount;
+        batch.counts.push_back(indexCount);
+        batch.offsets.push_back(reinterpret_cast<const void *>(indexOffset));
+        batch.baseVertices.push_back(mesh.baseVertex);
+        return batch;
+    }
+
+    std::vector<uint64_t> keys, keyScratch;
+    std::vector<uint32_t> items, itemScratch, visible;
+    std::vector<DrawBatch> batches, conditionalBatches;
+    bool valid = false;
+    uint64_t modelVersion = 0, occlusionVersion = 0;
+    glm::mat4 lastModelView{1.0f}, lastProj{1.0f};
+    int lastViewportHeight = 0;
+};
+
+// Command-line options. Flags take the form --name or --name=value; the first other argument is the model to load.
+struct ViewerOptions
+{
+    std::string modelPath;
+    size_t textureUploadBudgetMB = 16; // --texture-budget-mb: texture bytes streamed to the GPU per frame, 0 = unlimited
+    bool compactVertices = false;      // --compact-vertices: quantized 20-byte vertices instead of 44-byte floats
+    bool optimizeMeshes = false;       // --optimize-meshes: vertex cache and vertex fetch reordering after packing
+    bool optimizeOverdraw = false;     // --optimize-overdraw: also sort triangle clusters against overdraw (implies --optimize-meshes)
+    bool glStats = false;              // --gl-stats: log GL state calls issued/elided per frame once a second
+    bool occlusionCulling = false;     // --occlusion-culling: skip meshes hidden behind others using occlusion queries
+    bool softwareOcclusion = false;    // --software-occlusion: skip meshes hidden behind the largest meshes, tested on the CPU
+    bool continuousRedraw = false;     // --continuous-redraw: draw every frame even when nothing changed
+    bool generateLods = false;         // --lod: generate simplified detail levels and draw distant meshes with them
+    float lodErrorPixels = 1.0f;       // --lod-error: largest on-screen error of a detail level, in pixels
+    bool lowMemory = false;            // --low-memory: pack in small batches and free imported data early
+    bool benchmarkPacking = false;     // --benchmark-packing: log scalar vs. SIMD vertex packing throughput at startup
+    bool selfTest = false;             // --self-test: check the SIMD vertex packing against the scalar loop and exit
+    bool nativeGltf = true;            // --no-native-gltf: import glTF files through Assimp instead of the native loader
+
+    static ViewerOptions parse(int argc, char **argv)
+    {
+        ViewerOptions options;
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            if (arg.rfind("--", 0) != 0)
+            {
+                if (options.modelPath.empty())
+                    options.modelPath = arg;
+                continue;
+            }
+            size_t eq = arg.find('=');
+            std::string name = arg.substr(2, eq == std::string::npos ? std::string::npos : eq - 2);
+            std::string value = eq == std::string::npos ? std::string() : arg.substr(eq + 1);
+
+            if (name == "texture-budget-mb")
+                options.textureUploadBudgetMB = std::strtoull(value.c_str(), nullptr, 10);
+            else if (name == "compact-vertices")
+                options.compactVertices = true;
+            else if (name == "optimize-meshes")
+                options.optimizeMeshes = true;
+            else if (name == "optimize-overdraw")
+                options.optimizeMeshes = options.optimizeOverdraw = true;
+            else if (name == "gl-stats")
+                options.glStats = true;
+            else if (name == "occlusion-culling")
+                options.occlusionCulling = true;
+            else if (name == "software-occlusion")
+                options.softwareOcclusion = true;
+            else if (name == "continuous-redraw")
+                options.continuousRedraw = true;
+            else if (name == "lod")
+                options.generateLods = true;
+            else if (name == "lod-error")
+                options.lodErrorPixels = std::strtof(value.c_str(), nullptr);
+            else if (name == "low-memory")
+                options.lowMemory = true;
+            else if (name == "benchmark-packing")
+                options.benchmarkPacking = true;
+            else if (name == "self-test")
+                options.selfTest = true;
+            else if (name == "no-native-gltf")
+                options.nativeGltf = false;
+            else
+                spdlog::warn("Unknown option: {}", arg);
+        }
+        return options;
+    }
+};
+
 // Global key callback function
 void GlobalKeyCallback(GLFWwindow *window, int key, int scancode, int action, int mods)
 {
@@ -760,6 +6693,9 @@ void GlobalKeyCallback(GLFWwindow *window, int key, int scancode, int action, in
 
 int main(int argc, char **argv)
 {
+    ViewerOptions options = ViewerOptions::parse(argc, argv);
+    if (options.selfTest)
+        return SelfTestVertexPacking() ? 0 : 1; // Needs no window, so it also runs headless (ctest)
 
     // --- GLFW & GLAD Initialization ---
     glfwInit();
@@ -783,28 +6719,34 @@ int main(int argc, char **argv)
     glfwSwapInterval(1);
     glfwSetDropCallback(window, drop_callback); // Set file drop callback
 
-    std::vector<Mesh> meshes_main; // Holds the meshes of the currently loaded model
-    std::string statusMessage;     // Used to display status information in the window title
+    if (options.benchmarkPacking)
+        BenchmarkVertexPacking();
+    g_textureRegistry.uploader.budgetPerFrame = options.textureUploadBudgetMB << 20;
+
+    Model model_main;            // Holds the meshes and texture references of the currently loaded model
+    std::string statusMessage;   // Used to display status information in the window title
+    ModelLoader modelLoader;     // Imports models in the background while model_main keeps rendering
+    RenderQueue renderQueue;     // Draw order of model_main, kept across frames
+    std::string loadingFilename; // Filename of the model currently being loaded
+    modelLoader.settings.vertexFormat = options.compactVertices ? VertexFormat::Compact : VertexFormat::Float;
+    modelLoader.settings.optimizeMeshes = options.optimizeMeshes;
+    modelLoader.settings.optimizeOverdraw = options.optimizeOverdraw;
+    modelLoader.settings.generateLods = options.generateLods;
+    modelLoader.settings.lowMemory = options.lowMemory;
+    modelLoader.settings.nativeGltf = options.nativeGltf;
+    renderQueue.lodErrorPixels = options.lodErrorPixels;
+    modelLoader.wake = []()
+    { glfwPostEmptyEvent(); }; // Wake the render loop to map the arena for a load or pick up its result
 
     // --- Optional: Load initial model from command line ---
-    if (argc > 1)
+    if (!options.modelPath.empty())
     {
-        std::string fullPath = argv[1];
-        std::string filename = std::filesystem::path(fullPath).filename().string();
-        std::string directory = std::filesystem::path(fullPath).parent_path().string(); // Get model directory
+        std::string fullPath = options.modelPath;
+        loadingFilename = std::filesystem::path(fullPath).filename().string();
         spdlog::info("Attempting to load model from command line: {}", fullPath);
 
-        meshes_main = loadModel(fullPath, directory); // Pass directory
-        if (meshes_main.empty())
-        {
-            statusMessage = "Error loading initial: " + filename + ". Drag & drop."; // Use filename
-            spdlog::error("{}", statusMessage);
-        }
-        else
-        {
-            statusMessage = "Loaded: " + filename; // Use filename
-            spdlog::info("Successfully loaded initial model: {}", fullPath);
-        }
+        modelLoader.request(fullPath);
+        statusMessage = "Loading: " + loadingFilename + "..."; // Use filename
     }
     else
     {
@@ -822,6 +6764,18 @@ int main(int argc, char **argv)
     }
 
     // --- Initialize light configuration ---
+    // Per-draw uniforms are resolved once; per-frame state goes through the FrameData uniform buffer
+    MeshUniforms meshUniforms(shader);
+    shader.bindUniformBlock("FrameData", kFrameUniformBinding);
+    shader.use();
+    glUniform1i(shader.uniformLocation("uDiffuseSampler"), 0); // Diffuse textures always use texture unit 0
+    glUniform1i(shader.uniformLocation("uInstanceMatrices"), kInstanceTextureUnit);
+    GLuint frameUniformBuffer = 0;
+    glGenBuffers(1, &frameUniformBuffer);
+    g_glState.bindBuffer(GL_UNIFORM_BUFFER, frameUniformBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), nullptr, GL_DYNAMIC_DRAW);
+    g_glState.bindUniformBufferBase(kFrameUniformBinding, frameUniformBuffer);
+
     LightConfig pointLight;
     pointLight.position = glm::vec3(3.0f, 3.0f, 3.0f); // Light position
     pointLight.color = glm::vec3(1.0f, 1.0f, 1.0f);    // White light
@@ -829,6 +6783,15 @@ int main(int argc, char **argv)
     pointLight.specularStrength = 0.6f;                // Specular reflection intensity
     pointLight.shininess = 64.0f;                      // More focused specular highlight
 
+    OcclusionCuller occlusionCuller;
+    SoftwareOcclusion softwareOcclusion;
+    SoftwareOcclusion *software = options.softwareOcclusion ? &softwareOcclusion : nullptr;
+    if (options.occlusionCulling && !occlusionCuller.init())
+    {
+        spdlog::warn("Occlusion culling shaders unavailable, drawing without occlusion culling");
+        options.occlusionCulling = false;
+    }
+
     CameraController camera(window);
     glfwSetKeyCallback(window, GlobalKeyCallback);
 
@@ -836,125 +6799,188 @@ int main(int argc, char **argv)
     glClearColor(0.2f, 0.25f, 0.3f, 1.0f); // Set background color
 
     float totalRotationAngle = 0.0f; // Accumulates the rotation angle
-    float lastFrameTime = 0.0f;      // Time of the last frame
+    float lastFrameTime = 0.0f;      // Time of the last loop iteration
     constexpr float ROTATION_SPEED = 0.5f;
 
     lastFrameTime = (float)glfwGetTime(); // Initialize lastFrameTime before the loop starts
 
+    // Render on demand: a frame is only drawn when something visible changed (camera, model, framebuffer size,
+    // rotation, a texture finishing its upload, or the window being exposed). Otherwise the loop sleeps in
+    // glfwWaitEventsTimeout; a finished load posts an empty event to wake it.
+    constexpr double kIdleWaitSeconds = 1.0;             // Longest sleep while nothing happens
+    constexpr double kStreamingWaitSeconds = 1.0 / 60.0; // Pace of texture streaming while no frames are drawn
+    bool animating = false;                              // Whether the last iteration rotated the model
+    glm::mat4 drawnView(0.0f);                           // State the last frame was drawn with
+    int drawnWidth = -1, drawnHeight = -1;
+    uint64_t drawnModelVersion = 0;
+    WindowTitleState windowTitle;
+    glfwSetWindowRefreshCallback(window, WindowRefreshCallback);
+
+    // --gl-stats: GL state calls over the current reporting interval
+    double statsStartTime = glfwGetTime();
+    size_t statsFrames = 0, statsIssued = 0, statsElided = 0;
+
     // --- Render Loop ---
     while (!glfwWindowShouldClose(window))
     {
-        glfwPollEvents(); // Process events
+        if (animating || options.continuousRedraw)
+            glfwPollEvents(); // Process events
+        else
+            glfwWaitEventsTimeout(g_textureRegistry.uploader.busy() ? kStreamingWaitSeconds : kIdleWaitSeconds);
 
         // --- Check if a new model needs to be loaded via drag-and-drop ---
         if (g_newModelPathAvailable)
         {
             std::string currentDroppedFullPath = g_droppedModelPath;
-            std::string currentDroppedFilename = std::filesystem::path(currentDroppedFullPath).filename().string();
-            std::string currentDroppedDirectory = std::filesystem::path(currentDroppedFullPath).parent_path().string();
+            loadingFilename = std::filesystem::path(currentDroppedFullPath).filename().string();
 
             g_droppedModelPath.clear();      // Clear global path string
             g_newModelPathAvailable = false; // Reset flag
 
             spdlog::info("Processing dropped file: {}", currentDroppedFullPath);
-            std::vector<Mesh> newMeshes = loadModel(currentDroppedFullPath, currentDroppedDirectory); // Pass directory
-            if (!newMeshes.empty())
+            modelLoader.request(currentDroppedFullPath); // Cancels a load that is still in flight
+            statusMessage = "Loading: " + loadingFilename + "...";
+        }
+
+        // --- Swap in a model once its background load has finished (GL upload happens here) ---
+        if (std::unique_ptr<ModelData> loaded = modelLoader.poll())
+        {
+            if (!loaded->meshes.empty())
             {
-                meshes_main = std::move(newMeshes);                  // RAII: Old Mesh objects in meshes_main are destructed
-                statusMessage = "Loaded: " + currentDroppedFilename; // Use filename
-                spdlog::info("Successfully loaded model from: {}", currentDroppedFullPath);
+                model_main = uploadModel(*loaded);            // RAII: Old meshes and texture references are released
+                statusMessage = "Loaded: " + loadingFilename; // Use filename
+                spdlog::info("Successfully loaded model from: {}", loaded->path);
+                loaded.reset(); // Release the CPU-side data before measuring
+                MemoryUsage memory = GetMemoryUsage();
+#ifdef __linux__
+                const char *peakSince = "the load started (including cancelled loads still running then)";
+#else
+                const char *peakSince = "startup";
+#endif
+                if (memory.peakResident > 0)
+                    spdlog::info("Peak memory since {}: {} MiB (resident now: {} MiB)", peakSince, memory.peakResident >> 20, memory.resident >> 20);
             }
             else
             {
-                meshes_main.clear();                                                           // RAII: Clear potentially existing old model to show error/prompt status
-                statusMessage = "Error loading: " + currentDroppedFilename + ". Drag & drop."; // Use filename
-                spdlog::error("Failed to load model from dropped file: {}", currentDroppedFullPath);
+                model_main = Model();                                                   // RAII: Clear potentially existing old model to show error/prompt status
+                statusMessage = "Error loading: " + loadingFilename + ". Drag & drop."; // Use filename
+                spdlog::error("Failed to load model from: {}", loaded->path);
             }
         }
 
-        int w, h; // Framebuffer width and height
-        glfwGetFramebufferSize(window, &w, &h);
-        glViewport(0, 0, w, h);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        // --- Stream pending texture uploads within this frame's budget ---
+        bool texturesCompleted = g_textureRegistry.processUploads();
+
+        // --- Window title, only rebuilt and set when what it shows changed ---
+        windowTitle.update(window, statusMessage, !model_main.empty(), modelLoader.busy(), g_autoRotateModel);
 
-        if (meshes_main.empty())
+        float currentFrameTime = (float)glfwGetTime();
+        float deltaTime = currentFrameTime - lastFrameTime;
+        lastFrameTime = currentFrameTime;
+
+        bool rotating = g_autoRotateModel && !model_main.empty();
+        if (rotating && animating)
         {
-            // If no model is loaded, update window title with status/prompt
-            glfwSetWindowTitle(window, ("Model Viewer - " + statusMessage).c_str());
-            // Background is cleared by glClear; future text rendering could go here
+            totalRotationAngle += ROTATION_SPEED * deltaTime; // Time spent asleep before rotation resumed does not count
         }
-        else
-        {
-            std::string titleBase = "Model Viewer";
-            if (!statusMessage.empty() && statusMessage.rfind("Loaded: ", 0) == 0)
-            {
-                titleBase += " - " + statusMessage.substr(8);
-            }
-
-            // Append rotation status to title
-            if (g_autoRotateModel)
-            {
-                // titleBase += " (Rotating)";
-            }
-            else
-            {
-                titleBase += " (Paused)";
-            }
+        animating = rotating;
 
-            glfwSetWindowTitle(window, titleBase.c_str());
+        int w, h; // Framebuffer width and height
+        glfwGetFramebufferSize(window, &w, &h);
+        glm::vec3 camPos;
+        glm::mat4 view = camera.getViewMatrix(camPos);
 
-            float currentFrameTime = (float)glfwGetTime();
-            float deltaTime = currentFrameTime - lastFrameTime;
-            lastFrameTime = currentFrameTime;
+        // --- Skip the frame if it would look exactly like the last one ---
+        bool redraw = rotating || options.continuousRedraw || g_redrawRequested || texturesCompleted || view != drawnView ||
+                      w != drawnWidth || h != drawnHeight || model_main.version != drawnModelVersion;
+        if (!redraw)
+            continue;
+        g_redrawRequested = false;
+        drawnView = view;
+        drawnWidth = w;
+        drawnHeight = h;
+        drawnModelVersion = model_main.version;
 
-            if (g_autoRotateModel)
-            {
-                totalRotationAngle += ROTATION_SPEED * deltaTime;
-            }
+        glViewport(0, 0, w, h);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+        // Without a model only the background is drawn; the title shows the status/prompt
+        if (!model_main.empty())
+        {
             glm::mat4 model_matrix = glm::rotate(glm::mat4(1.f), totalRotationAngle, glm::vec3(0.f, 1.f, 0.f));
-
-            glm::vec3 camPos;
-            glm::mat4 view = camera.getViewMatrix(camPos);
             glm::mat4 proj = glm::perspective(glm::radians(45.f), (h == 0 ? 1.0f : w / (float)h), 0.1f, 100.f);
 
-            shader.use();
-            // Set common uniforms
-            glUniformMatrix4fv(glGetUniformLocation(shader.id, "uModel"), 1, GL_FALSE, glm::value_ptr(model_matrix));
-            glUniformMatrix4fv(glGetUniformLocation(shader.id, "uView"), 1, GL_FALSE, glm::value_ptr(view));
-            glUniformMatrix4fv(glGetUniformLocation(shader.id, "uProj"), 1, GL_FALSE, glm::value_ptr(proj));
-            glUniform3fv(glGetUniformLocation(shader.id, "uViewPos"), 1, glm::value_ptr(camPos));
-            glUniform3fv(glGetUniformLocation(shader.id, "uLightPos"), 1, glm::value_ptr(pointLight.position));
-            glUniform3fv(glGetUniformLocation(shader.id, "uLightColor"), 1, glm::value_ptr(pointLight.color));
-            glUniform1f(glGetUniformLocation(shader.id, "uAmbientStrength"), pointLight.ambientStrength);
-            glUniform1f(glGetUniformLocation(shader.id, "uSpecularStrength"), pointLight.specularStrength);
-            glUniform1f(glGetUniformLocation(shader.id, "uShininess"), pointLight.shininess);
-
-            // Set diffuse texture sampler uniform to texture unit 0 (needs to be set once as it doesn't change)
-            glUniform1i(glGetUniformLocation(shader.id, "uDiffuseSampler"), 0);
+            // Set common uniforms: one buffer update per frame
+            FrameUniforms frame;
+            frame.model = model_matrix;
+            frame.view = view;
+            frame.proj = proj;
+            frame.viewPos = glm::vec4(camPos, 1.0f);
+            frame.lightPos = glm::vec4(pointLight.position, 1.0f);
+            frame.lightColor = glm::vec4(pointLight.color, 1.0f);
+            frame.lightParams = glm::vec4(pointLight.ambientStrength, pointLight.specularStrength, pointLight.shininess, 0.0f);
+            g_glState.bindBuffer(GL_UNIFORM_BUFFER, frameUniformBuffer);
+            glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), nullptr, GL_DYNAMIC_DRAW); // Orphan last frame's copy
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), &frame);
 
-            for (auto &mesh_obj : meshes_main)
+            // Frustum-culled, sorted by texture and front-to-back; replayed as-is while nothing moves
+            glm::mat4 modelView = view * model_matrix;
+            if (options.occlusionCulling)
+            {
+                occlusionCuller.collectResults(model_main);
+                submitBatches(renderQueue.build(model_main, modelView, proj, h, &occlusionCuller, software), shader, meshUniforms);
+                occlusionCuller.issueQueries(model_main, renderQueue.visibleItems(), modelView);
+                submitBatches(renderQueue.occludedBatches(), shader, meshUniforms);
+            }
+            else
             {
-                mesh_obj.draw(shader); // Pass shader to draw function
+                submitBatches(renderQueue.build(model_main, modelView, proj, h, nullptr, software), shader, meshUniforms);
             }
         }
         glfwSwapBuffers(window);
-    }
 
-    // Clean up Mesh objects' GL resources (VAO/VBO/EBO) before OpenGL context is destroyed
-    // Mesh's RAII destructor is called when meshes_main.clear() or meshes_main goes out of scope.
-    // Calling meshes_main.clear() here while context is valid is good practice.
-    meshes_main.clear();
-
-    // --- Clean up loaded textures ---
-    for (const auto &texInfo : g_loadedTexturesCache)
-    {
-        if (texInfo.id != 0)
+        auto [issued, elided] = g_glState.takeCounters();
+        if (options.glStats)
         {
-            glDeleteTextures(1, &texInfo.id);
+            statsFrames++;
+            statsIssued += issued;
+            statsElided += elided;
+            double now = glfwGetTime();
+            if (now - statsStartTime >= 1.0)
+            {
+                spdlog::info("GL state per frame: {:.1f} calls issued, {:.1f} elided ({} frames, draw list {} rebuilt / {} replayed)",
+                             double(statsIssued) / statsFrames, double(statsElided) / statsFrames, statsFrames,
+                             renderQueue.rebuilds, renderQueue.replays);
+                spdlog::info("Meshes visible: {} / {} (culling {:.3f} ms per rebuild)", renderQueue.visibleMeshes, renderQueue.totalMeshes,
+                             renderQueue.rebuilds ? renderQueue.cullSeconds * 1000.0 / renderQueue.rebuilds : 0.0);
+                if (options.generateLods)
+                    spdlog::info("Detail levels: {} of {} triangles drawn", renderQueue.trianglesDrawn, renderQueue.trianglesFull);
+                if (options.softwareOcclusion)
+                    spdlog::info("Software occlusion: {} meshes hidden behind {} occluder triangles", renderQueue.softwareOccluded,
+                                 softwareOcclusion.trianglesDrawn);
+                if (options.occlusionCulling)
+                    spdlog::info("Occlusion: {} of the visible meshes hidden, {:.1f} queries per frame", renderQueue.occludedMeshes,
+                                 double(occlusionCuller.issued) / statsFrames);
+                occlusionCuller.issued = 0;
+                renderQueue.rebuilds = renderQueue.replays = 0;
+                renderQueue.cullSeconds = 0.0;
+                statsStartTime = now;
+                statsFrames = statsIssued = statsElided = 0;
+            }
         }
     }
-    g_loadedTexturesCache.clear();
+
+    // Release the model's texture references and the shared geometry before the OpenGL context is destroyed
+    // Model's RAII destructor would do the same when model_main goes out of scope, but by then the context is gone.
+    // Loads still running may be packing into the arena, so they are stopped first.
+    modelLoader.cancelAll();
+    model_main = Model();
+    g_geometryArena.clear();
+    occlusionCuller.clear();
+    g_glState.deleteBuffer(frameUniformBuffer);
+
+    // --- Clean up any textures that are still resident ---
+    g_textureRegistry.clear();
 
     glfwDestroyWindow(window);
     glfwTerminate();
@@ -6,15 +6,17 @@ in vec2 vTexCoords;   // Texture coordinates (from vertex shader)
 
 out vec4 FragColor; // Output fragment color
 
-// --- Lighting parameters (set from C++) ---
-uniform vec3 uLightPos;         // Light position in world space
-uniform vec3 uLightColor;       // Light color
-uniform float uAmbientStrength;   // Ambient light intensity
-uniform float uSpecularStrength;  // Specular light intensity
-uniform float uShininess;         // Shininess factor for specular highlights
-
-// --- Other Uniforms ---
-uniform vec3 uViewPos;          // Observer/camera position in world space
+// --- Per-frame camera and lighting parameters (set once per frame from C++, see vs.glsl) ---
+layout(std140) uniform FrameData
+{
+    mat4 uModel;        // Model matrix
+    mat4 uView;         // View matrix
+    mat4 uProj;         // Projection matrix
+    vec4 uViewPos;      // Observer/camera position in world space (xyz)
+    vec4 uLightPos;     // Light position in world space (xyz)
+    vec4 uLightColor;   // Light color (rgb)
+    vec4 uLightParams;  // Ambient strength, specular strength, shininess
+};
 
 // --- Texture samplers ---
 uniform sampler2D uDiffuseSampler;    // Diffuse texture sampler
@@ -32,20 +34,20 @@ void main()
 
     // --- Lighting Calculation ---
     // 1. Ambient light
-    vec3 ambient = uAmbientStrength * uLightColor;
+    vec3 ambient = uLightParams.x * uLightColor.rgb;
 
     // 2. Diffuse light
     vec3 norm = normalize(Normal); // Normalize the normal vector
-    vec3 lightDir = normalize(uLightPos - FragPos); // Direction from fragment to light source
+    vec3 lightDir = normalize(uLightPos.xyz - FragPos); // Direction from fragment to light source
     float diff = max(dot(norm, lightDir), 0.0);     // Diffuse intensity (dot product, clamped to >= 0)
-    vec3 diffuse = diff * uLightColor;              // Diffuse light color
+    vec3 diffuse = diff * uLightColor.rgb;             // Diffuse light color
 
     // 3. Specular light
-    vec3 viewDir = normalize(uViewPos - FragPos);    // Direction from fragment to viewer
+    vec3 viewDir = normalize(uViewPos.xyz - FragPos);    // Direction from fragment to viewer
     vec3 reflectDir = reflect(-lightDir, norm);      // Reflected light direction
                                                      // (-lightDir because reflect expects vector from light to surface)
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), uShininess); // Specular highlight intensity
-    vec3 specular = uSpecularStrength * spec * uLightColor;          // Specular light color
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), uLightParams.z); // Specular highlight intensity
+    vec3 specular = uLightParams.y * spec * uLightColor.rgb;         // Specular light color
 
     // Final color = (sum of light components) * material's base color
     vec3 result = (ambient + diffuse + specular) * materialBaseColor;
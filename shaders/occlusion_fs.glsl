@@ -0,0 +1,7 @@
+#version 330 core
+out vec4 FragColor; // Color writes are masked off while proxies are drawn; only the sample count matters
+
+void main()
+{
+    FragColor = vec4(1.0);
+}
@@ -0,0 +1,22 @@
+#version 330 core
+layout(location = 0) in vec3 aPos; // Unit cube corner (-1..1)
+
+// Per-frame state, shared with the model shader (must match FrameUniforms in main.cpp)
+layout(std140) uniform FrameData
+{
+    mat4 uModel;        // Model matrix
+    mat4 uView;         // View matrix
+    mat4 uProj;         // Projection matrix
+    vec4 uViewPos;      // Camera position in world space (xyz)
+    vec4 uLightPos;     // Light position in world space (xyz)
+    vec4 uLightColor;   // Light color (rgb)
+    vec4 uLightParams;  // Ambient strength, specular strength, shininess
+};
+
+uniform vec3 uBoxCenter; // Proxy box of the queried mesh, in model space
+uniform vec3 uBoxExtent; // Half size of the box
+
+void main()
+{
+    gl_Position = uProj * uView * uModel * vec4(uBoxCenter + aPos * uBoxExtent, 1.0);
+}
@@ -4,19 +4,57 @@ layout(location = 1) in vec3 aNormal;     // Vertex normal
 layout(location = 2) in vec3 aColor;      // Vertex color
 layout(location = 3) in vec2 aTexCoords;  // Texture coordinates
 
-uniform mat4 uModel; // Model matrix
-uniform mat4 uView;  // View matrix
-uniform mat4 uProj;  // Projection matrix
+// Per-frame state, updated once per frame from C++ (must match FrameUniforms in main.cpp)
+layout(std140) uniform FrameData
+{
+    mat4 uModel;        // Model matrix
+    mat4 uView;         // View matrix
+    mat4 uProj;         // Projection matrix
+    vec4 uViewPos;      // Camera position in world space (xyz)
+    vec4 uLightPos;     // Light position in world space (xyz)
+    vec4 uLightColor;   // Light color (rgb)
+    vec4 uLightParams;  // Ambient strength, specular strength, shininess
+};
+
+uniform vec3 uPositionOffset;    // Compact vertices: aPos is unorm16 across the mesh bounds
+uniform vec3 uPositionScale;     // (offset 0 / scale 1 for float vertices)
+uniform bool uOctahedralNormals; // Compact vertices: aNormal.xy is an octahedral encoding
+
+uniform bool uInstanced;                 // Meshes referenced by several nodes are drawn instanced
+uniform int uInstanceBase;               // First transform of this mesh in uInstanceMatrices
+uniform samplerBuffer uInstanceMatrices; // Column-major instance transforms, four texels per matrix
 
 out vec3 FragPos;      // Fragment position in world space
 out vec3 Normal;       // Normal in world space
 out vec3 VertexColor;  // Vertex color to be passed to fragment shader
 out vec2 vTexCoords;   // Texture coordinates to be passed to fragment shader
 
+// Decodes an octahedral-encoded unit vector
+vec3 decodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+
+// Node transform of the current instance
+mat4 instanceMatrix()
+{
+    int base = (uInstanceBase + gl_InstanceID) * 4;
+    return mat4(texelFetch(uInstanceMatrices, base),
+                texelFetch(uInstanceMatrices, base + 1),
+                texelFetch(uInstanceMatrices, base + 2),
+                texelFetch(uInstanceMatrices, base + 3));
+}
+
 void main()
 {
-    FragPos = vec3(uModel * vec4(aPos, 1.0));
-    Normal  = mat3(transpose(inverse(uModel))) * aNormal; // Calculate normal in world space
+    vec3 position = aPos * uPositionScale + uPositionOffset;
+    vec3 normal = uOctahedralNormals ? decodeOctahedral(aNormal.xy) : aNormal;
+    mat4 world = uInstanced ? uModel * instanceMatrix() : uModel;
+    FragPos = vec3(world * vec4(position, 1.0));
+    Normal  = mat3(transpose(inverse(world))) * normal; // Calculate normal in world space
     VertexColor = aColor;       // Pass through vertex color
     vTexCoords = aTexCoords;    // Pass through texture coordinates
     gl_Position = uProj * uView * vec4(FragPos, 1.0);